@@ -32,9 +32,36 @@
 //#define USE_UART1_RXF_ISR
 //#define USE_UART1_TXE_ISR
 #define USE_TIM2_UPD_ISR
+/// ADC end-of-conversion interrupt, see adc_isr()
+#define USE_ADC_ISR
+/// ADC oversampling: 4^ADC_OS_BITS conversions per adc_task(), alternating between both probes:
+/// 2 = 16 (default), 3 = 64, 4 = 256 conversions. The display is off meanwhile.
+#define ADC_OS_BITS (2)
+/// ADC: median-of-3 prefilter per probe ahead of the IIR filter, rejects single spikes
+//#define ADC_MEDIAN
+/// ADC: adaptive IIR filter, a fast time-constant after a real temperature change.
+/// Step response and noise against the fixed filter: tools/host/adc_test
+#define ADC_ADAPTIVE
 
 //#define OVBSC
 
+/// scheduler: next release of a task = previous release + period (no drift)
+#define SCHED_DRIFT_FREE
+
+/// scheduler: measure run-time and start-latency of every task (uses TIM1)
+//#define SCHED_STATS
+/// scheduler: keep the task names (task_name[]) in flash for debugging
+//#define SCHED_DEBUG
+/// scheduler: choose the phase of every task at start-up to avoid simultaneous releases,
+/// tools/host/sched_phase makes the same choice offline for the Delay column of TASK_DATA
+//#define SCHED_AUTO_PHASE
+
+/// idle: use active-halt (display off, AWU wake-up) while the thermostat is switched off
+//#define SCHED_ACTIVE_HALT
+#if defined(SCHED_ACTIVE_HALT)
+  #define USE_AWU_ISR
+#endif
+
 /*-----------------------------------------------------------------------------
     END OF MODULE DEFINITION FOR MULTIPLE INLUSION
 -----------------------------------------------------------------------------*/
@@ -23,48 +23,946 @@
   ==================================================================
 */ 
 #include "eep.h"
+#include "stc1000p_lib.h"
+
+config_t cfg;                       // RAM copy of the menu-items in EEPROM
+uint8_t  cfg_dirty[CFG_DIRTY_BYTES]; // 1 bit per menu-item, 1 = not written to EEPROM yet
+#if !(defined(OVBSC))
+uint16_t cfg_pwr_on;                // RAM copy of the power-on flag
+uint8_t  ring_slot;                 // slot of the newest record in the ring
+uint8_t  ring_seq;                  // sequence number of the newest record in the ring
+bool     ring_pending = false;      // true = new ring record, written by eeprom_poll()
+
+// The runtime state that is stored in the ring instead of its own word
+#define RING_ITEM(i) (((i) == SP) || ((i) == St) || ((i) == dh) || ((i) == rn))
+// The 4-byte blocks of a ring record in the write-queue
+#define RING_BLOCKS  (RING_REC_SIZE >> 1)
+#endif
+eep_block eep_q[EEP_QUEUE_SIZE]; // blocks waiting to be programmed, eep_q_head first
+uint8_t   eep_q_head = 0;       // oldest entry of eep_q[], programmed first
+uint8_t   eep_q_cnt  = 0;       // number of entries in eep_q[]
+bool      eep_busy   = false;   // true = eep_q[eep_q_head] is being programmed
+eep_entry eep_j[EEP_JOURNAL_SIZE]; // values of the current transaction
+uint8_t   eep_jn     = 0;       // number of entries in eep_j[], 0 = no transaction
+uint8_t   eep_ji     = 0;       // next entry of eep_j[] for eeprom_step()
+uint8_t   eep_jstate = EEP_J_IDLE; // EEP_J_IDLE..EEP_J_CLEAR, see eeprom_step()
+eep_entry eep_p[EEP_PEND_SIZE]; // profile values waiting for a transaction
+uint8_t   eep_pn     = 0;       // number of entries in eep_p[]
+
+extern bool fahrenheit; // false = Celsius, true = Fahrenheit
+
+// Default values of the menu-items, used when the EEPROM is not valid
+const int16_t cfg_default[] = { MENU_DATA(EEPROM_DEFAULTS) };
+
+// Index in layout 20 (no header) for every menu-item of the current layout
+#if defined(OVBSC)
+const uint8_t map_v20[] = {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 
+                            12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, // Sd..tc
+                            EEP_NONE, EEP_NONE, EEP_NONE,                   // C0, C5, C1
+                            24, 25, 26, 27, 28, 29, 30, 31, 32, 33 };       // Hc..ASd
+#define V20_ITEMS (34)
+#else
+const uint8_t map_v20[] = {  0,  1,  2,  3,  4,                             // SP..tc2
+                            EEP_NONE, EEP_NONE, EEP_NONE,                   // C0, C5, C1
+                            EEP_NONE, EEP_NONE, EEP_NONE,                   // C02, C52, C12
+                             5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18 }; // SA..rn
+#define V20_ITEMS (19)
+#endif
+
+// Layouts that config_load() can migrate, the current layout first
+const eep_migration eep_migrations[] = 
+{
+    { STC1000P_EEPROM_VERSION, NO_OF_MENU_ITEMS, false, 0 },
+    { 20,                      V20_ITEMS,        true,  map_v20 } // without header
+};
+#define NO_OF_MIGRATIONS (sizeof(eep_migrations)/sizeof(eep_migrations[0]))
+
+// EEADR_MENU of a layout: the size of its profiles
+#define EEP_LAYOUT_MENU(layout) ((uint8_t)((((layout) >> 4) & 0x0f) * (2 * ((layout) & 0x0f) + 1)))
+
+// Compile-time check: the configuration area must end before the journal,
+// the journal before the header.
+typedef char eep_check_size[(EEADR_CFG_END + 1 <= EEADR_JOURNAL) ? 1 : -1];
+typedef char eep_check_journal[(EEADR_JOURNAL + 2 + 2 * EEP_JOURNAL_SIZE <= EEADR_HEADER) ? 1 : -1];
+// The profile values of eep_p[] and the header fit in one transaction.
+typedef char eep_check_pending[(EEP_PEND_SIZE + 3 <= EEP_JOURNAL_SIZE) ? 1 : -1];
+// A copy of any configuration area (< EEADR_HEADER words) fits in the scratch
+// area, which is at the end of the EEPROM and (STC1000P) contains the ring.
+typedef char eep_check_scratch[((EEADR_HEADER <= EEP_SCRATCH_SIZE) && 
+                                (EEADR_SCRATCH + EEP_SCRATCH_SIZE <= 256)) ? 1 : -1];
+#if !(defined(OVBSC))
+typedef char eep_check_ring[((EEADR_RING >= EEADR_SCRATCH) && (EEADR_RING + RING_SLOTS * RING_REC_SIZE <= 
+                             EEADR_SCRATCH + EEP_SCRATCH_SIZE)) ? 1 : -1];
+// The copy of config_mark() does not reach the last slot of the ring, which
+// keeps the newest record during a rewrite, see ring_keep().
+typedef char eep_check_keep[(EEADR_SCRATCH + EEADR_HEADER <= EEADR_RING_KEEP) ? 1 : -1];
+// A ring record takes RING_BLOCKS entries of the write-queue, see eeprom_poll().
+typedef char eep_check_ring_blocks[(!(EEADR_RING & 0x01) && !(RING_REC_SIZE & 0x01)) ? 1 : -1];
+#endif
 
 /*-----------------------------------------------------------------------------
-  Purpose  : This function reads a (16-bit) value from the STM8 EEPROM.
+  Purpose  : This function finds the newest entry in the write-queue for
+             an EEPROM block.
+  Variables: blk: block number, the n-th 4-byte block within the EEPROM
+  Returns  : the index in eep_q[] or EEP_NONE if the block is not queued
+  ---------------------------------------------------------------------------*/
+uint8_t eeprom_find(uint8_t blk)
+{
+    uint8_t i, j;
+    uint8_t x = EEP_NONE;
+    
+    for (i = 0; i < eep_q_cnt; i++)
+    {
+        j = (eep_q_head + i) & (EEP_QUEUE_SIZE - 1);
+        if (eep_q[j].Blk == blk) x = j;
+    } // for
+    return x;
+} // eeprom_find()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function reads a (16-bit) value directly from the STM8 EEPROM.
+             A value that is still in the write-queue is read from there,
+             the values of a transaction are not seen, see eeprom_read().
   Variables: eeprom_address: the index number within the EEPROM. An index number
                              is the n-th 16-bit variable within the EEPROM.
   Returns  : the (16-bit value)
   ---------------------------------------------------------------------------*/
-uint16_t eeprom_read_config(uint8_t eeprom_address)
+uint16_t eeprom_read_queue(uint8_t eeprom_address)
 {
 	uint16_t data;
         char    *address = (char *)EEP_BASE_ADDR; //  EEPROM base address.
-	
-	address += (eeprom_address << 1); // convert to byte-address in EEPROM
+	uint8_t  i       = eeprom_find(eeprom_address >> 1);
+    
+	if (i != EEP_NONE)
+	{   // not programmed yet
+	    address = (char *)&eep_q[i].Data[(eeprom_address & 0x01) << 1];
+	} // if
+	else address += (eeprom_address << 1); // convert to byte-address in EEPROM
         data      = *address++;           // read MSB first
         data    <<= 8;                    // SHL 8
 	data     |= *address;             // read LSB
 	return data;                      // Return result
-} // eeprom_read_config()
+} // eeprom_read_queue()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function reads a (16-bit) value from the STM8 EEPROM. A value
+             of a transaction that is open or not completely written yet, or
+             a value that is still in the write-queue is read from there.
+  Variables: eeprom_address: the index number within the EEPROM. An index number
+                             is the n-th 16-bit variable within the EEPROM.
+  Returns  : the (16-bit value)
+  ---------------------------------------------------------------------------*/
+uint16_t eeprom_read(uint8_t eeprom_address)
+{
+    uint8_t i;
+    
+    for (i = 0; i < eep_jn; i++)
+        if (eep_j[i].Adr == eeprom_address) return eep_j[i].Data;
+    return eeprom_read_queue(eeprom_address);
+} // eeprom_read()
 
 /*-----------------------------------------------------------------------------
-  Purpose  : This function writes a (16-bit) value to the STM8 EEPROM.
+  Purpose  : This function puts a (16-bit) value in the write-queue. It does
+             not wait for the EEPROM: the value is put in the 4-byte block
+             of the write-queue, which is programmed in the background by
+             eeprom_poll(). Two values in the same block are programmed
+             together, but blocks are always programmed in the order of
+             the calls. It never waits: when the write-queue is full, the
+             value is not queued.
   Variables: eeprom_address: the index number within the EEPROM. An index number
                              is the n-th 16-bit variable within the EEPROM.
              data          : 16-bit value to write to the EEPROM
-  Returns  : -
+  Returns  : false = write-queue full, try again after eeprom_poll()
   ---------------------------------------------------------------------------*/
-void eeprom_write_config(uint8_t eeprom_address,uint16_t data)
+bool eeprom_queue(uint8_t eeprom_address,uint16_t data)
 {
-    char *address = (char *)EEP_BASE_ADDR; //  EEPROM base address.
+    uint8_t blk = eeprom_address >> 1;          // 4-byte block in EEPROM
+    uint8_t ofs = (eeprom_address & 0x01) << 1; // byte-offset within block
+    uint8_t i, j, k;
+    char    *src;
+    
+    // Avoid unnecessary EEPROM writes
+    if (data == eeprom_read_queue(eeprom_address)) return true;
+    
+    i = eeprom_find(blk);
+    j = (eep_q_head + eep_q_cnt - 1) & (EEP_QUEUE_SIZE - 1); // newest entry
+    if ((i != j) || (eep_busy && (i == eep_q_head)))
+    {   // Block not the newest entry or already being programmed: add a new entry
+        if (eep_q_cnt == EEP_QUEUE_SIZE) return false; // queue full
+        if (i != EEP_NONE)
+             src = (char *)eep_q[i].Data;              // new contents of block being programmed
+        else src = (char *)EEP_BASE_ADDR + (blk << 2); // current contents of block
+        j = (eep_q_head + eep_q_cnt) & (EEP_QUEUE_SIZE - 1);
+        eep_q[j].Blk = blk;
+        for (k = 0; k < 4; k++) eep_q[j].Data[k] = src[k];
+        eep_q_cnt++;
+        i = j;
+    } // if
+    eep_q[i].Data[ofs]     = (uint8_t)(data >> 8); // MSB first
+    eep_q[i].Data[ofs + 1] = (uint8_t)(data & 0xff);
+    return true;
+} // eeprom_queue()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : This function writes a (16-bit) value to the STM8 EEPROM, through
+             the write-queue, see eeprom_queue(). Within a transaction, the
+             value is added to the transaction and written by eeprom_commit().
+             A value of a transaction that is not completely written yet, is
+             written after that transaction.
+             It waits for the EEPROM when the write-queue or the journal is
+             full or the value is still in a transaction. This only happens
+             at power-up (config_load()): at run-time the tasks write with
+             eeprom_write_config() and config_flush(), which never wait.
+  Variables: eeprom_address: the index number within the EEPROM. An index number
+                             is the n-th 16-bit variable within the EEPROM.
+             data          : 16-bit value to write to the EEPROM
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void eeprom_write(uint8_t eeprom_address,uint16_t data)
+{
+    uint8_t i;
+    
     // Avoid unnecessary EEPROM writes
-    if (data == eeprom_read_config(eeprom_address)) return;
+    if (data == eeprom_read(eeprom_address)) return;
+    
+    for (i = 0; (i < eep_jn) && (eep_j[i].Adr != eeprom_address); i++) ;
+    if (eep_jstate == EEP_J_OPEN)
+    {   // Add to the current transaction
+        if (i == EEP_JOURNAL_SIZE)
+        {   // journal full: commit the values so far, continue in a new transaction
+            eeprom_commit();
+            while (!eeprom_begin()) eeprom_poll();
+            i = 0;
+        } // if
+        if (i == eep_jn) eep_jn++;
+        eep_j[i].Adr  = eeprom_address;
+        eep_j[i].Data = data;
+        return;
+    } // if
+    if (i < eep_jn) while (eep_jstate != EEP_J_IDLE) eeprom_poll(); // wait for the transaction
+    while (!eeprom_queue(eeprom_address, data)) eeprom_poll(); // queue full, wait
+} // eeprom_write()
 
-    address += (eeprom_address << 1); // convert to byte-address in EEPROM
+/*-----------------------------------------------------------------------------
+  Purpose  : This function programs the write-queue into the EEPROM, one
+             4-byte block at a time in WORD programming mode. It does not
+             wait for the EEPROM: it returns while a block is being
+             programmed and checks the EOP flag at the next call. A
+             committed transaction is added to the write-queue step by
+             step, when there is room for it, see eeprom_step(). Profile
+             values of eeprom_write_config() are started as a transaction
+             when the previous one has been written and a new ring record
+             is written when there is room for it. So when this function
+             returns with an empty write-queue and no transaction, there is
+             nothing left to write. It is called from the background loop
+             in main().
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void eeprom_poll(void)
+{
+    char    *address;
+    uint8_t i;
+    
+    if (eep_busy)
+    {
+        if (FLASH.IAPSR.reg.EOP == 0) return; // still programming, reading IAPSR clears EOP
+        eep_busy   = false;
+        eep_q_head = (eep_q_head + 1) & (EEP_QUEUE_SIZE - 1);
+        eep_q_cnt--;
+    } // if
+    if ((eep_jstate == EEP_J_IDLE) && eep_pn) config_pending(); // profile values
+    // every step adds at most 1 block to the write-queue
+    // and half of the write-queue is kept free for a ring record
+    while ((eep_jstate > EEP_J_OPEN) && (eep_q_cnt < (EEP_QUEUE_SIZE >> 1))) eeprom_step();
+#if !(defined(OVBSC))
+    if (ring_pending && (eep_jstate != EEP_J_OPEN) && (eep_q_cnt <= EEP_QUEUE_SIZE - RING_BLOCKS))
+    {   // room for the blocks of a ring record
+        ring_pending = false;
+        ring_write();
+    } // if
+#endif
+    if (eep_q_cnt == 0)
+    {
+        if (FLASH.IAPSR.reg.DUL) FLASH.IAPSR.reg.DUL = 0; // write-protect EEPROM again
+        return;
+    } // if
     //  Check if the EEPROM is write-protected.  If it is then unlock the EEPROM.
     if (FLASH.IAPSR.reg.DUL == 0)
     {
         FLASH.DUKR.byte = 0xae;
         FLASH.DUKR.byte = 0x56;
+        if (FLASH.IAPSR.reg.DUL == 0) return; // not unlocked yet, try again next call
     } // if
-    while (FLASH.IAPSR.reg.DUL == 0) ; // wait until EEPROM is unlocked
-    *address++ = (char)((data >> 8) & 0xff); // write MSB
-    *address   = (char)(data & 0xff);        // write LSB
-    FLASH.IAPSR.reg.DUL = 0;                     // write-protect EEPROM again
+    address = (char *)EEP_BASE_ADDR + (eep_q[eep_q_head].Blk << 2);
+    FLASH.CR2.reg.WPRG  = 1; // WORD programming: 4 bytes with 1 programming cycle
+    FLASH.NCR2.reg.WPRG = 0;
+    for (i = 0; i < 4; i++) *address++ = eep_q[eep_q_head].Data[i]; // starts after 4th byte
+    eep_busy = true;
+} // eeprom_poll()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function reads a (16-bit) configuration value. Menu-items
+             are read from their RAM copy in cfg, all other values (profiles,
+             power-on flag) are read from the EEPROM. A profile value that
+             waits for its transaction is read from eep_p[].
+  Variables: eeprom_address: the index number within the EEPROM. An index number
+                             is the n-th 16-bit variable within the EEPROM.
+  Returns  : the (16-bit value)
+  ---------------------------------------------------------------------------*/
+uint16_t eeprom_read_config(uint8_t eeprom_address)
+{
+    uint8_t i = eeprom_address - EEADR_MENU; // menu-item number
+    
+    if (i < NO_OF_MENU_ITEMS) return CFG_ITEM(i);
+#if !(defined(OVBSC))
+    if (eeprom_address == EEADR_POWER_ON) return cfg_pwr_on;
+#endif
+    for (i = 0; i < eep_pn; i++)
+        if (eep_p[i].Adr == eeprom_address) return eep_p[i].Data; // profile value not written yet
+    return eeprom_read(eeprom_address);
+} // eeprom_read_config()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function writes a (16-bit) configuration value. A menu-item
+             is written to its RAM copy in cfg and marked as dirty, it is
+             written to the EEPROM by the next config_flush(). The power-on
+             flag is written with a new ring record by eeprom_poll(). A
+             profile value is kept in eep_p[], eeprom_poll() writes it with
+             the new CRC of the header in a transaction, see
+             config_pending(). This function never waits for the EEPROM.
+  Variables: eeprom_address: the index number within the EEPROM. An index number
+                             is the n-th 16-bit variable within the EEPROM.
+             data          : 16-bit value to write
+  Returns  : false = not written, EEP_PEND_SIZE profile values are waiting
+             already: try again later
+  ---------------------------------------------------------------------------*/
+bool eeprom_write_config(uint8_t eeprom_address,uint16_t data)
+{
+    uint8_t i = eeprom_address - EEADR_MENU; // menu-item number
+    
+    if (i < NO_OF_MENU_ITEMS)
+    {
+        if (CFG_ITEM(i) == (int16_t)data) return true; // nothing changed
+        CFG_ITEM(i)         = (int16_t)data;
+        cfg_dirty[i >> 3] |= (1 << (i & 0x07));
+    } // if
+#if !(defined(OVBSC))
+    else if (eeprom_address == EEADR_POWER_ON)
+    {
+        cfg_pwr_on   = data;
+        ring_pending = true;
+    } // else if
+#endif
+    else if (eeprom_address < EEADR_CFG_END)
+    {   // profile: add it to eep_p[], or replace the value waiting there
+        if (data == eeprom_read_config(eeprom_address)) return true; // nothing changed
+        for (i = 0; (i < eep_pn) && (eep_p[i].Adr != eeprom_address); i++) ;
+        if (i == EEP_PEND_SIZE) return false; // eep_p[] full
+        if (i == eep_pn) eep_pn++;
+        eep_p[i].Adr  = eeprom_address;
+        eep_p[i].Data = data;
+    } // else if
+    else eeprom_write(eeprom_address, data);
+    return true;
 } // eeprom_write_config()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function writes the profile values of eep_p[] in one
+             transaction with the new CRC of the header. It does not wait:
+             when the previous transaction is still being written, they
+             stay in eep_p[] for the next call. Called by eeprom_poll().
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void config_pending(void)
+{
+    uint8_t i;
+    
+    if (!eeprom_begin()) return; // previous transaction not written yet
+    for (i = 0; i < eep_pn; i++) eeprom_write(eep_p[i].Adr, eep_p[i].Data);
+    config_header();
+    eep_pn = 0;
+    eeprom_commit();
+} // config_pending()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function starts a transaction. All eeprom_write() calls
+             until eeprom_commit() are kept in RAM (max. EEP_JOURNAL_SIZE
+             values) and are written to the EEPROM all together or not at
+             all, also when the power fails halfway, see eeprom_commit().
+             Only one transaction can be open or written at a time.
+  Variables: -
+  Returns  : false = the previous transaction is still being written,
+             try again later
+  ---------------------------------------------------------------------------*/
+bool eeprom_begin(void)
+{
+    if (eep_jstate != EEP_J_IDLE) return false;
+    eep_jn     = 0;
+    eep_jstate = EEP_J_OPEN;
+    return true;
+} // eeprom_begin()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function ends a transaction. It does not wait: the
+             transaction is added to the write-queue by eeprom_poll(),
+             as soon as there is room for it. Until then, eeprom_read()
+             reads its values from RAM.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void eeprom_commit(void)
+{
+    eep_ji     = 0;
+    eep_jstate = eep_jn ? EEP_J_JOURNAL : EEP_J_IDLE;
+} // eeprom_commit()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function adds the next step of a committed transaction to
+             the write-queue, every step is 1 block of the EEPROM. In the
+             order of programming:
+             1) EEP_J_JOURNAL: the address and value of every entry are
+                written to the journal in EEPROM;
+             2) EEP_J_COMMIT : the commit word and its check-word are
+                written: from here on, the transaction is committed;
+             3) EEP_J_HOME   : every value is written to its own address;
+             4) EEP_J_CLEAR  : the commit word is cleared.
+             If the power fails before 2), the journal is ignored at power-up
+             and nothing has changed. If it fails after 2), eeprom_recover()
+             writes all values again at power-up.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void eeprom_step(void)
+{
+    uint16_t w;
+    
+    switch (eep_jstate)
+    {
+        case EEP_J_JOURNAL:
+            eeprom_queue(EEADR_JOURNAL + 2 + (eep_ji << 1), eep_j[eep_ji].Adr);
+            eeprom_queue(EEADR_JOURNAL + 3 + (eep_ji << 1), eep_j[eep_ji].Data);
+            if (++eep_ji == eep_jn) eep_jstate = EEP_J_COMMIT;
+            break;
+        case EEP_J_COMMIT:
+            w = (EEP_JMAGIC << 8) | eep_jn;
+            eeprom_queue(EEADR_JOURNAL    , w);
+            eeprom_queue(EEADR_JOURNAL + 1, eeprom_crc(EEADR_JOURNAL + 2, eep_jn << 1) ^ w);
+            eep_ji     = 0;
+            eep_jstate = EEP_J_HOME;
+            break;
+        case EEP_J_HOME:
+            eeprom_queue(eep_j[eep_ji].Adr, eep_j[eep_ji].Data);
+            if (++eep_ji == eep_jn) eep_jstate = EEP_J_CLEAR;
+            break;
+        default: // EEP_J_CLEAR
+            eeprom_queue(EEADR_JOURNAL    , 0);
+            eeprom_queue(EEADR_JOURNAL + 1, 0);
+            eep_jn     = 0; // all values are in the write-queue now
+            eep_jstate = EEP_J_IDLE;
+            break;
+    } // switch
+} // eeprom_step()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function finishes a transaction that was committed, but
+             not completely written when the power failed: all values in
+             the journal are written again. A journal without a valid
+             commit word is ignored (the transaction is rolled back) and a
+             partly written commit word is cleared. It is called at
+             power-up, before the EEPROM is used.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void eeprom_recover(void)
+{
+    uint8_t  i, n;
+    uint16_t w = eeprom_read(EEADR_JOURNAL);
+    
+    n = (uint8_t)(w & 0xff);
+    if (((w >> 8) == EEP_JMAGIC) && (n <= EEP_JOURNAL_SIZE) &&
+        (eeprom_read(EEADR_JOURNAL + 1) == (eeprom_crc(EEADR_JOURNAL + 2, n << 1) ^ w)))
+    {   // committed: write all values again
+        for (i = 0; i < n; i++)
+            eeprom_write((uint8_t)eeprom_read(EEADR_JOURNAL + 2 + (i << 1)),
+                         eeprom_read(EEADR_JOURNAL + 3 + (i << 1)));
+    } // if
+    eeprom_write(EEADR_JOURNAL    , 0);
+    eeprom_write(EEADR_JOURNAL + 1, 0);
+} // eeprom_recover()
+
+#if !(defined(OVBSC))
+/*-----------------------------------------------------------------------------
+  Purpose  : This function calculates the check-word of a ring record. An 
+             all-zero (never written) record does not have a valid check-word.
+  Variables: w: pointer to the first 3 words of the record
+  Returns  : the check-word
+  ---------------------------------------------------------------------------*/
+uint16_t ring_check(uint16_t *w)
+{
+    uint16_t chk = 0x5a5a;
+
+    chk = ((chk << 1) | (chk >> 15)) + w[0]; // rotate-left and add
+    chk = ((chk << 1) | (chk >> 15)) + w[1];
+    chk = ((chk << 1) | (chk >> 15)) + w[2];
+    return ~chk;
+} // ring_check()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function finds the newest valid record in the ring and 
+             copies it into cfg and cfg_pwr_on. Records with an invalid
+             check-word (never written or interrupted by a power-down) are 
+             skipped. If there's no valid record, the values that are 
+             already in cfg and cfg_pwr_on are kept.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void ring_load(void)
+{
+    uint16_t w[RING_REC_SIZE];
+    uint8_t  i, j, adr;
+    bool     found = false;
+    
+    ring_slot = RING_SLOTS - 1; // next ring_write() starts at slot 0
+    ring_seq  = 0;
+    for (i = 0; i < RING_SLOTS; i++)
+    {
+        adr = EEADR_RING + i * RING_REC_SIZE;
+        for (j = 0; j < RING_REC_SIZE; j++) w[j] = eeprom_read(adr + j);
+        if ((w[3] == ring_check(w)) && 
+            (!found || ((int8_t)((uint8_t)(w[2] >> 8) - ring_seq) > 0)))
+        {   // valid and newer than the newest record found so far
+            found      = true;
+            ring_slot  = i;
+            ring_seq   = (uint8_t)(w[2] >> 8);
+            cfg.SP     = (int16_t)w[0];
+            cfg.dh     = (int16_t)w[1];
+            cfg.rn     = (w[2] >> 4) & 0x07;
+            cfg.St     = w[2] & 0x0f;
+            cfg_pwr_on = ((w[2] & RING_FLAG_PWR) == RING_FLAG_PWR);
+        } // if
+    } // for
+} // ring_load()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function writes SP, dh, rn, St and the power-on flag as a
+             new record in the next slot of the ring, so that every slot 
+             is written only once per RING_SLOTS updates. The check-word is
+             written last, an interrupted write leaves the previous record
+             as the newest valid one.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void ring_write(void)
+{
+    uint16_t w[RING_REC_SIZE];
+    uint8_t  j, adr;
+    
+    if (++ring_slot >= RING_SLOTS) ring_slot = 0;
+    w[0] = (uint16_t)cfg.SP;
+    w[1] = (uint16_t)cfg.dh;
+    w[2] = ((uint16_t)++ring_seq << 8) | ((cfg.rn & 0x07) << 4) | (cfg.St & 0x0f);
+    if (cfg_pwr_on) w[2] |= RING_FLAG_PWR;
+    w[3] = ring_check(w);
+    adr  = EEADR_RING + ring_slot * RING_REC_SIZE;
+    for (j = 0; j < RING_REC_SIZE; j++) eeprom_write(adr + j, w[j]);
+} // ring_write()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function copies the newest record of the ring, found by
+             ring_load(), into the last slot (EEADR_RING_KEEP) before 
+             config_mark() uses the scratch area. The copy of config_mark()
+             and config_unmark() leave this slot alone, so after a rewrite 
+             the ring starts again with the live SP, dh, rn, St and power-on
+             flag. The check-word is written last: until then, the record
+             in its own slot is still the newest valid one.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void ring_keep(void)
+{
+    uint8_t j, adr = EEADR_RING + ring_slot * RING_REC_SIZE;
+    
+    if (ring_slot == RING_SLOTS - 1) return; // already there (or no record)
+    for (j = 0; j < RING_REC_SIZE; j++) eeprom_write(EEADR_RING_KEEP + j, eeprom_read(adr + j));
+} // ring_keep()
+#endif
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function calculates the CRC-16 (CCITT, 0x1021, initial 
+             value 0xFFFF) of n words of the EEPROM, MSB first.
+  Variables: eeprom_address: the index number of the first word
+             n             : number of 16-bit words
+  Returns  : the CRC-16
+  ---------------------------------------------------------------------------*/
+uint16_t eeprom_crc(uint8_t eeprom_address, uint8_t n)
+{
+    uint16_t crc = 0xffff;
+    uint16_t w;
+    uint8_t  i, j;
+    
+    for (i = 0; i < n; i++)
+    {
+        w = eeprom_read(eeprom_address + i);
+        for (j = 0; j < 16; j++)
+        {
+            if ((crc ^ w) & 0x8000) crc = (crc << 1) ^ 0x1021;
+            else                    crc <<= 1;
+            w <<= 1;
+        } // for
+    } // for
+    return crc;
+} // eeprom_crc()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function writes the header of the configuration area: 
+             EEP_MAGIC, EEP_LAYOUT and the CRC-16 of the configuration area.
+             It should be written in the same transaction as the changes of
+             the configuration area.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void config_header(void)
+{
+    eeprom_write(EEADR_HEADER    , EEP_MAGIC);
+    eeprom_write(EEADR_HEADER + 1, EEP_LAYOUT);
+    eeprom_write(EEADR_HEADER + 2, eeprom_crc(0, EEADR_CFG_END));
+} // config_header()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function checks the menu-items in cfg of an EEPROM without 
+             header (without CRC), to reject an erased or random image.
+  Variables: -
+  Returns  : true = menu-items are within their limits
+  ---------------------------------------------------------------------------*/
+bool config_sane(void)
+{
+    uint8_t i;
+    bool    zero = true;
+    
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++) if (CFG_ITEM(i)) zero = false;
+    if (zero) return false; // erased EEPROM
+#if defined(OVBSC)
+    return (((uint16_t)cfg.CF <= 1) && ((uint16_t)cfg.cP <= 1) && 
+            ((uint16_t)cfg.APF <= 511) && ((uint16_t)cfg.PF <= 31));
+#else
+    return (((uint16_t)cfg.CF <= 1) && ((uint16_t)cfg.HrS <= 1) && ((uint16_t)cfg.rP <= 1) &&
+            ((uint16_t)cfg.Pb2 <= 2) && ((uint16_t)cfg.rn <= THERMOSTAT_MODE) && 
+            ((uint16_t)cfg.St < NO_OF_TT_PAIRS) && ((uint16_t)cfg.dh <= 999) && 
+            ((uint16_t)cfg.cd <= 60) && ((uint16_t)cfg.hd <= 60) && (cfg_pwr_on <= 1));
+#endif
+} // config_sane()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function sets all menu-items in cfg to their default value
+             from MENU_DATA and clears all profiles.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void config_defaults(void)
+{
+    uint8_t i;
+    
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++) CFG_ITEM(i) = cfg_default[i];
+#if !(defined(OVBSC))
+    for (i = 0; i < EEADR_MENU; i++) eeprom_write(i, 0); // profiles
+    cfg_pwr_on = 1;
+#endif
+} // config_defaults()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function finds the migration for a layout of the
+             configuration area.
+  Variables: layout: EEP_LAYOUT of the configuration area
+  Returns  : the migration or 0 if the layout cannot be migrated
+  ---------------------------------------------------------------------------*/
+const eep_migration *config_migration(uint16_t layout)
+{
+    const eep_migration *m = 0;
+    uint8_t i;
+    
+    for (i = 0; i < NO_OF_MIGRATIONS; i++)
+        if (eep_migrations[i].Version == (uint8_t)(layout >> 8)) m = &eep_migrations[i];
+    if (m && (EEP_LAYOUT_MENU(layout) + m->Items >= EEADR_HEADER)) m = 0; // does not fit
+#if defined(OVBSC)
+    if ((uint8_t)layout) m = 0; // no profiles, a corrupted layout
+#endif
+    return m;
+} // config_migration()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function returns the number of words of a configuration
+             area: profiles, menu-items and (not OVBSC) the power-on flag.
+  Variables: layout: EEP_LAYOUT of the configuration area
+  Returns  : the number of words, 0 for EEP_DEFAULT_LAYOUT
+  ---------------------------------------------------------------------------*/
+uint8_t config_size(uint16_t layout)
+{
+    const eep_migration *m = config_migration(layout);
+    
+    if (!m) return 0;
+#if defined(OVBSC)
+    return EEP_LAYOUT_MENU(layout) + m->Items;
+#else
+    return EEP_LAYOUT_MENU(layout) + m->Items + 1;
+#endif
+} // config_size()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function copies the menu-items of a configuration area
+             into cfg (and cfg_pwr_on), in the current order.
+  Variables: m  : the layout of the configuration area
+             adr: the index number of its first menu-item
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void config_read(const eep_migration *m, uint8_t adr)
+{
+    uint8_t i, j;
+    
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++)
+    {
+        j = m->Map ? m->Map[i] : i;
+        if (j == EEP_NONE) CFG_ITEM(i) = cfg_default[i];
+        else               CFG_ITEM(i) = (int16_t)eeprom_read(adr + j);
+    } // for
+#if !(defined(OVBSC))
+    cfg_pwr_on = eeprom_read(adr + m->Items); // used if the ring is still empty
+#endif
+} // config_read()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function converts the copy of a configuration area with an
+             older layout in the scratch area, of which the menu-items are
+             already in cfg. Temperatures stored in display units are
+             converted into E-1 degrees Celsius and the profiles are written
+             to their current addresses. A profile with less steps is ended
+             with a duration of 0, a profile with more steps is cut off.
+             Because the old values are read from the copy, the conversion
+             can be done again after a power-down.
+  Variables: m       : the older layout
+             profiles: NO_OF_PROFILES of the older layout
+             pairs   : NO_OF_TT_PAIRS of the older layout
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void config_migrate(const eep_migration *m, uint8_t profiles, uint8_t pairs)
+{
+    uint8_t i;
+#if !(defined(OVBSC))
+    uint8_t  p, k, old_size = 2 * pairs + 1;
+    int16_t  w;
+#else
+    (void)profiles; (void)pairs; // no profiles
+#endif
+    
+    fahrenheit = (m->Disp && cfg.CF);
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++)
+        CFG_ITEM(i) = disp_to_temp(CFG_ITEM(i), config_temp_type(EEADR_MENU + i));
+#if !(defined(OVBSC))
+    for (i = 0; i < EEADR_MENU; i++)
+    {
+        p = i / PROFILE_SIZE;
+        k = i - p * PROFILE_SIZE;
+        if (p >= profiles)                 w = 0; // new profile
+        else if (!(k & 0x01))
+        {   // setpoint, the last one is repeated if there are more steps
+            w = eeprom_read(EEADR_SCRATCH + p * old_size + ((k < old_size) ? k : old_size - 1));
+            w = disp_to_temp(w, TEMP_ABS);
+        } // else if
+        else if (k < old_size)            w = eeprom_read(EEADR_SCRATCH + p * old_size + k); // duration
+        else                              w = 0;  // end of profile
+        eeprom_write(i, w);
+    } // for
+#endif
+    fahrenheit = false; // set again by ctrl_task()
+} // config_migrate()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function checks the configuration area in the EEPROM and
+             copies its menu-items into cfg.
+             - Header and CRC valid: the layout of the header.
+             - No header, but sane menu-items of the layout without header:
+               EEP_LEGACY_LAYOUT.
+             - Otherwise (corrupted or unknown): EEP_DEFAULT_LAYOUT.
+  Variables: -
+  Returns  : the layout of the configuration area
+  ---------------------------------------------------------------------------*/
+uint16_t config_check(void)
+{
+    const eep_migration *m;
+    uint16_t layout = eeprom_read(EEADR_HEADER + 1);
+    uint8_t  old_menu;
+    bool     hdr;
+    
+    hdr = (eeprom_read(EEADR_HEADER) == EEP_MAGIC) || ((layout == EEP_LAYOUT) &&
+          (eeprom_read(EEADR_HEADER + 2) == eeprom_crc(0, EEADR_CFG_END))); // only magic corrupted
+    if (!hdr) layout = EEP_LEGACY_LAYOUT;
+    m = config_migration(layout);
+    if (!m) return EEP_DEFAULT_LAYOUT;
+    old_menu = EEP_LAYOUT_MENU(layout);
+    config_read(m, old_menu);
+    if (hdr ? (eeprom_read(EEADR_HEADER + 2) == eeprom_crc(0, old_menu + m->Items))
+            : config_sane()) return layout;
+    return EEP_DEFAULT_LAYOUT;
+} // config_check()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function starts a rewrite of the configuration area: the
+             configuration area is copied into the scratch area and then the
+             marker (layout and check-word) is written. Until config_unmark(),
+             config_load() redoes the rewrite from this copy after a
+             power-down, the old configuration area is never converted twice.
+  Variables: layout: EEP_LAYOUT of the configuration area or EEP_DEFAULT_LAYOUT
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void config_mark(uint16_t layout)
+{
+    uint8_t i, n = config_size(layout);
+    
+    for (i = 0; i < n; i++) eeprom_write(EEADR_SCRATCH + i, eeprom_read(i));
+    eeprom_write(EEADR_MARKER    , layout); // same 4-byte block as the check-word
+    eeprom_write(EEADR_MARKER + 1, eeprom_crc(EEADR_SCRATCH, n) ^ layout ^ EEP_MAGIC);
+} // config_mark()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function ends a rewrite of the configuration area. The
+             check-word of the marker is cleared first, so that an
+             interrupted clean-up is never taken for an interrupted rewrite.
+             The scratch area is cleared, for the STC1000P this also clears
+             the ring, except for the record kept by ring_keep().
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void config_unmark(void)
+{
+    uint8_t i;
+    
+    eeprom_write(EEADR_MARKER + 1, 0);
+    for (i = 0; i < EEP_SCRATCH_CLEAR; i++) eeprom_write(EEADR_SCRATCH + i, 0);
+    eeprom_write(EEADR_MARKER    , 0);
+} // config_unmark()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function writes a new configuration area with the current
+             layout: migrated from the copy in the scratch area or with the
+             default values. The header is written last.
+  Variables: layout: EEP_LAYOUT of the copy or EEP_DEFAULT_LAYOUT
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void config_rewrite(uint16_t layout)
+{
+    const eep_migration *m = config_migration(layout);
+    uint8_t i;
+    
+    if (m)
+    {
+        config_read(m, EEADR_SCRATCH + EEP_LAYOUT_MENU(layout));
+        config_migrate(m, (layout >> 4) & 0x0f, layout & 0x0f);
+    } // if
+    else config_defaults();
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++) eeprom_write(EEADR_MENU + i, CFG_ITEM(i));
+#if !(defined(OVBSC))
+    eeprom_write(EEADR_POWER_ON, cfg_pwr_on);
+#endif
+    config_header();
+} // config_rewrite()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function checks the configuration area in the EEPROM and
+             copies all menu-items into cfg. It should be called once at
+             power-up, before any menu-item is used.
+             - Header and CRC valid, current layout: the menu-items are read.
+             - Header and CRC valid, older layout in eep_migrations[], or no
+               header but sane menu-items of the layout without header: the
+               configuration area is migrated to the current layout.
+             - Otherwise (corrupted or unknown): all menu-items are set to
+               their default value and all profiles are cleared.
+             A migration or a reset to the default values that was
+             interrupted by a power-down is done again first, see
+             config_mark(). The runtime state (SP, St, dh, rn and the
+             power-on flag) is then taken from the newest record in the
+             ring, if any, also after a rewrite: see ring_keep().
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void config_load(void)
+{
+    uint16_t layout;
+    uint8_t  i;
+    
+    eeprom_recover(); // finish a transaction that was interrupted by a power-down
+    layout = eeprom_read(EEADR_MARKER);
+    if (layout || eeprom_read(EEADR_MARKER + 1))
+    {   // rewrite of the configuration area interrupted by a power-down
+        if (eeprom_read(EEADR_MARKER + 1) ==
+            (eeprom_crc(EEADR_SCRATCH, config_size(layout)) ^ layout ^ EEP_MAGIC))
+            config_rewrite(layout); // copy is complete: redo it
+        config_unmark();
+    } // if
+    layout = config_check();
+    if (layout != EEP_LAYOUT)
+    {   // Write the new configuration area and header, keep the runtime state
+#if !(defined(OVBSC))
+        ring_load(); // newest record, before config_mark() overwrites the ring
+        ring_keep();
+#endif
+        config_mark(layout);
+        config_rewrite(layout);
+        config_unmark();
+    } // if
+    else if (eeprom_read(EEADR_HEADER) != EEP_MAGIC) config_header(); // repair magic
+    for (i = 0; i < CFG_DIRTY_BYTES; i++) cfg_dirty[i] = 0x00;
+#if !(defined(OVBSC))
+    ring_load();
+#endif
+} // config_load()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function writes all dirty menu-items of cfg to the EEPROM.
+             Only changed menu-items are written, a clean cfg costs a few 
+             byte compares. They are written in one transaction with the 
+             new CRC of the header. Menu-items that do not fit in the
+             transaction, or all of them when the previous transaction is
+             still being written, stay dirty for the next call. Changes of
+             SP, St, dh and rn are written together as one new record in 
+             the ring, by eeprom_poll().
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void config_flush(void)
+{
+    uint8_t i, mask;
+    bool    crc  = false;
+#if !(defined(OVBSC))
+    bool    ring = false;
+#endif
+    
+    if (!eeprom_begin()) return; // previous transaction not written yet
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++)
+    {
+        if (!(i & 0x07) && !cfg_dirty[i >> 3])
+        {   // no dirty menu-items in this byte of cfg_dirty[]
+            i += 7;
+            continue;
+        } // if
+        mask = (1 << (i & 0x07));
+        if (cfg_dirty[i >> 3] & mask)
+        {
+#if !(defined(OVBSC))
+            if (RING_ITEM(i)) ring = true;
+            else
+#endif
+            {
+                if (eep_jn > EEP_JOURNAL_SIZE - 4) continue; // keep room for the header
+                eeprom_write(EEADR_MENU + i, (uint16_t)CFG_ITEM(i));
+                crc = true;
+            } // else
+            cfg_dirty[i >> 3] &= ~mask;
+        } // if
+    } // for
+    if (crc) config_header();
+    eeprom_commit();
+#if !(defined(OVBSC))
+    if (ring) ring_pending = true; // a ring record is power-fail safe by itself
+#endif
+} // config_flush()
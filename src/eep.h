@@ -34,8 +34,77 @@
 // EEPROM base address within STM8 uC
 #define EEP_BASE_ADDR (0x4000)
 
+// Write-queue for eeprom_write(), an entry is a 4-byte EEPROM block
+#define EEP_QUEUE_SIZE (8)    // must be a power of 2
+#define EEP_NONE       (0xff) // returned by eeprom_find() if not found
+
+// Profile values of eeprom_write_config() waiting for a transaction, see
+// config_pending(). They are written with the 3 words of the header.
+#define EEP_PEND_SIZE  (4)
+
+typedef struct _eep_block
+{
+	uint8_t Blk;     // block number, the n-th 4-byte block within the EEPROM
+	uint8_t Data[4]; // new contents of the block, MSB of every value first
+} eep_block;
+
+// State of the transaction, see eeprom_begin() and eeprom_step()
+#define EEP_J_IDLE    (0) // no transaction
+#define EEP_J_OPEN    (1) // eeprom_begin() called, values are kept in RAM
+#define EEP_J_JOURNAL (2) // eeprom_commit() called, journal entries next
+#define EEP_J_COMMIT  (3) // commit word next
+#define EEP_J_HOME    (4) // values to their own address next
+#define EEP_J_CLEAR   (5) // clear commit word next
+
+// Entry of a transaction, see eeprom_begin()
+typedef struct _eep_entry
+{
+	uint8_t  Adr;    // index number within the EEPROM
+	uint16_t Data;   // new value
+} eep_entry;
+
+// Older layout of the configuration area that config_load() can migrate
+typedef struct _eep_migration
+{
+	uint8_t       Version; // STC1000P_EEPROM_VERSION of the layout
+	uint8_t       Items;   // number of menu-items in the layout
+	bool          Disp;    // true = temperatures stored in display units (C or F)
+	const uint8_t *Map;    // old index of every menu-item, EEP_NONE = default, 0 = same index
+} eep_migration;
+
 // Function prototypes
+uint8_t  eeprom_find(uint8_t blk);
+uint16_t eeprom_read_queue(uint8_t eeprom_address);
+uint16_t eeprom_read(uint8_t eeprom_address);
+bool     eeprom_queue(uint8_t eeprom_address,uint16_t data);
+void     eeprom_write(uint8_t eeprom_address,uint16_t data);
+void     eeprom_poll(void);
+bool     eeprom_begin(void);
+void     eeprom_commit(void);
+void     eeprom_step(void);
+void     eeprom_recover(void);
+uint16_t eeprom_crc(uint8_t eeprom_address, uint8_t n);
 uint16_t eeprom_read_config(uint8_t eeprom_address);
-void     eeprom_write_config(uint8_t eeprom_address,uint16_t data);
+bool     eeprom_write_config(uint8_t eeprom_address,uint16_t data);
+void     config_pending(void);
+#if !(defined(OVBSC))
+uint16_t ring_check(uint16_t *w);
+void     ring_load(void);
+void     ring_write(void);
+void     ring_keep(void);
+#endif
+void     config_header(void);
+bool     config_sane(void);
+void     config_defaults(void);
+const eep_migration *config_migration(uint16_t layout);
+uint8_t  config_size(uint16_t layout);
+void     config_read(const eep_migration *m, uint8_t adr);
+void     config_migrate(const eep_migration *m, uint8_t profiles, uint8_t pairs);
+uint16_t config_check(void);
+void     config_mark(uint16_t layout);
+void     config_unmark(void);
+void     config_rewrite(uint16_t layout);
+void     config_load(void);
+void     config_flush(void);
 
 #endif
@@ -0,0 +1,24 @@
+/*==================================================================
+  File Name    : ntc_table.h
+  ------------------------------------------------------------------
+  Purpose : NTC lookup table for ad_to_temp(), only included by temp.c
+            Default table for the 10k NTC probe of the STC-1000, the
+            table of the STC1000+ before the generator. The generator
+            reproduces it with custom_ntc_args of platformio.ini:
+              tools/ntc_table.py --sh 8.725e-4 2.540e-4 1.822e-7 --rs 9975 --size 32
+            i.e. Steinhart-Hart A=8.725e-4 B=2.540e-4 C=1.822e-7, a
+            9975 Ohm series resistor (fitted to the table, the nominal
+            resistor is 10k), NTC to Vref and 32 entries. Entries 1..31
+            match within 1 (0.1 C), entry 0 is extrapolated and only
+            used for out-of-limits values. For another probe, regenerate
+            this file with tools/ntc_table.py (pio run -t ntc_table).
+  ==================================================================
+*/
+#ifndef NTC_TABLE_H
+#define NTC_TABLE_H
+
+#define NTC_TABLE_BITS (5) // 32 entries
+
+/* Temperature lookup table in E-1 degrees Celsius */
+const int ad_lookup_c[] = {0,-486,-355,-270,-205,-151,-104,-61,-21,16,51,85,119,152,184,217,250,284,318,354,391,431,473,519,569,624,688,763,856,977,1154,1482};
+#endif
@@ -82,7 +82,7 @@ void ovbsc_fsm(void)
              ovbsc_pid_on = false; // disable PID controller
              if (ovbsc_run_prg)
              {   // ovbsc_run_prg is set to by Run Mode Parameter (rUn)
-                 countdown = eeprom_read_config(EEADR_MENU_ITEM(Sd)); /* Strike delay */	
+                 countdown = cfg.Sd; /* Strike delay */	
                  ovbsc_pid_on    = false; // disable PID-controller / SSR
                  ovbsc_pump_on   = false;
                  prg_state       = PRG_WAIT_STRIKE;
@@ -92,22 +92,22 @@ void ovbsc_fsm(void)
                  if (ovbsc_thermostat)
                  {   // manual mode: set fixed temperature
                      ovbsc_pid_on = true; // enable PID controller
-                     setpoint     = eeprom_read_config(EEADR_MENU_ITEM(cSP));
+                     setpoint     = cfg.cSP;
                  } 
                  else 
                  {   // manual mode: set constant output
-                     pid_out = 10 * eeprom_read_config(EEADR_MENU_ITEM(cO));
+                     pid_out = 10 * cfg.cO;
                  } // else
-                 ovbsc_pump_on = eeprom_read_config(EEADR_MENU_ITEM(cP));
+                 ovbsc_pump_on = cfg.cP;
              } // else
              break;
         //---------------------------------------------------------------------
         case PRG_WAIT_STRIKE:
              if (countdown == 0)
              {   // strike delay timer time-out
-                 countdown     = eeprom_read_config(EEADR_MENU_ITEM(ASd)); /* Safety shutdown timer */
+                 countdown     = cfg.ASd; /* Safety shutdown timer */
                  ovbsc_pid_on  = true; // enable PID-controller / SSR
-                 ovbsc_pump_on = (eeprom_read_config(EEADR_MENU_ITEM(PF)) >> 0) & 0x1;
+                 ovbsc_pump_on = (cfg.PF >> 0) & 0x1;
                  prg_state     = PRG_STRIKE;
              } // if
              else if (ovbsc_off)
@@ -117,14 +117,14 @@ void ovbsc_fsm(void)
              break;
         //---------------------------------------------------------------------
         case PRG_STRIKE:
-             setpoint = eeprom_read_config(EEADR_MENU_ITEM(St)); /* Strike temp */
+             setpoint = cfg.St; /* Strike temp */
              if (temp_ntc1 >= setpoint)
              {
-                 sound_alarm = (eeprom_read_config(EEADR_MENU_ITEM(APF)) >> 0) & 0x1;
+                 sound_alarm = (cfg.APF >> 0) & 0x1;
                  al_led_10 = LED_S;
                  al_led_1  = LED_t;
                  al_led_01 = LED_OFF;
-                 countdown = eeprom_read_config(EEADR_MENU_ITEM(ASd)); /* Safety shutdown timer */
+                 countdown = cfg.ASd; /* Safety shutdown timer */
                  prg_state = PRG_STRIKE_WAIT_ALARM;
              } // if
              else if ((countdown == 0) || ovbsc_off)
@@ -137,10 +137,10 @@ void ovbsc_fsm(void)
         case PRG_STRIKE_WAIT_ALARM:
              if (!sound_alarm)
              {
-                 ovbsc_pause = (eeprom_read_config(EEADR_MENU_ITEM(APF)) >> 1) & 0x1;
+                 ovbsc_pause = (cfg.APF >> 1) & 0x1;
                  mashstep    = 0;
-                 countdown   = eeprom_read_config(EEADR_MENU_ITEM(ASd));  // Safety shutdown timer
-                 ovbsc_pump_on = (eeprom_read_config(EEADR_MENU_ITEM(PF)) >> 1) & 0x1;
+                 countdown   = cfg.ASd;  // Safety shutdown timer
+                 ovbsc_pump_on = (cfg.PF >> 1) & 0x1;
                  prg_state   = PRG_INIT_MASH_STEP;
              } // if
              else if ((countdown == 0) || ovbsc_off)
@@ -151,12 +151,12 @@ void ovbsc_fsm(void)
              break;
         //---------------------------------------------------------------------
         case PRG_INIT_MASH_STEP:
-             setpoint   = eeprom_read_config(EEADR_MENU_ITEM(Pt1) + (mashstep << 1)); /* Mash step temp */
+             setpoint   = CFG_ITEM(Pt1 + (mashstep << 1)); /* Mash step temp */
              if (!ovbsc_pause && ((temp_ntc1 >= setpoint) || 
-                                  (eeprom_read_config(EEADR_MENU_ITEM(Pd1) + (mashstep << 1)) == 0)))
+                                  (CFG_ITEM(Pd1 + (mashstep << 1)) == 0)))
              {
-                 countdown = eeprom_read_config(EEADR_MENU_ITEM(Pd1) + (mashstep << 1)); /* Mash step duration */
-                 ovbsc_pump_on = (eeprom_read_config(EEADR_MENU_ITEM(PF)) >> 2) & 0x1;
+                 countdown = CFG_ITEM(Pd1 + (mashstep << 1)); /* Mash step duration */
+                 ovbsc_pump_on = (cfg.PF >> 2) & 0x1;
                  prg_state = PRG_MASH;
              } 
              else if ((countdown == 0) || ovbsc_off)
@@ -169,15 +169,15 @@ void ovbsc_fsm(void)
         case PRG_MASH:
              if (countdown == 0)
              {
-                 countdown = eeprom_read_config(EEADR_MENU_ITEM(ASd));
+                 countdown = cfg.ASd;
                  if (++mashstep < 6)
                  {
-                     ovbsc_pump_on = (eeprom_read_config(EEADR_MENU_ITEM(PF)) >> 1) & 0x1;
+                     ovbsc_pump_on = (cfg.PF >> 1) & 0x1;
                      prg_state = PRG_INIT_MASH_STEP;
                  } // if
                  else 
                  {
-                     sound_alarm = (eeprom_read_config(EEADR_MENU_ITEM(APF)) >> 2) & 0x1;
+                     sound_alarm = (cfg.APF >> 2) & 0x1;
                      al_led_10 = LED_b;
                      al_led_1  = LED_U;
                      al_led_01 = LED_OFF;
@@ -193,9 +193,9 @@ void ovbsc_fsm(void)
         case PRG_WAIT_BOIL_UP_ALARM:
              if (!sound_alarm)
              {
-                 ovbsc_pause   = (eeprom_read_config(EEADR_MENU_ITEM(APF)) >> 3) & 0x1;
-                 countdown     = eeprom_read_config(EEADR_MENU_ITEM(ASd));
-                 ovbsc_pump_on = (eeprom_read_config(EEADR_MENU_ITEM(PF)) >> 3) & 0x1;
+                 ovbsc_pause   = (cfg.APF >> 3) & 0x1;
+                 countdown     = cfg.ASd;
+                 ovbsc_pump_on = (cfg.PF >> 3) & 0x1;
                  prg_state     = PRG_INIT_BOIL_UP;
              } // if
              else if ((countdown == 0) || ovbsc_off)
@@ -206,10 +206,10 @@ void ovbsc_fsm(void)
              break;
         //---------------------------------------------------------------------
         case PRG_INIT_BOIL_UP:
-             if (!ovbsc_pause && (temp_ntc1 >= eeprom_read_config(EEADR_MENU_ITEM(Ht))))
+             if (!ovbsc_pause && (temp_ntc1 >= cfg.Ht))
              {   /* Boil up temp */
-                 countdown     = eeprom_read_config(EEADR_MENU_ITEM(Hd)); /* Hotbreak duration */
-                 ovbsc_pump_on = (eeprom_read_config(EEADR_MENU_ITEM(PF)) >> 4) & 0x1;
+                 countdown     = cfg.Hd; /* Hotbreak duration */
+                 ovbsc_pump_on = (cfg.PF >> 4) & 0x1;
                  prg_state     = PRG_HOTBREAK;
              } // if
              else if ((countdown==0) || ovbsc_off)
@@ -222,7 +222,7 @@ void ovbsc_fsm(void)
         case PRG_HOTBREAK:
              if (countdown == 0)
              {
-                 countdown     = eeprom_read_config(EEADR_MENU_ITEM(bd)); /* Boil duration */ 
+                 countdown     = cfg.bd; /* Boil duration */ 
                  ovbsc_pump_on = false;
                  prg_state     = PRG_BOIL;
              } // if
@@ -237,9 +237,9 @@ void ovbsc_fsm(void)
              i     = 0;
              while (!found && (i < 4))
              {
-                 if ((countdown == eeprom_read_config(EEADR_MENU_ITEM(hd1) + i)) && (sec_countdown > 57))
+                 if ((countdown == CFG_ITEM(hd1 + i)) && (sec_countdown > 57))
                  {   /* Hop timer */
-                     sound_alarm = (eeprom_read_config(EEADR_MENU_ITEM(APF)) >> (4+i)) & 0x1;
+                     sound_alarm = (cfg.APF >> (4+i)) & 0x1;
                      al_led_10   = LED_h;
                      al_led_1    = LED_d;
                      al_led_01   = led_lookup[i+1];
@@ -253,7 +253,7 @@ void ovbsc_fsm(void)
                  ovbsc_run_prg = false;
                  prg_state     = PRG_OFF;
                  ovbsc_pid_on  = false; // disable PID controller
-                 sound_alarm   = (eeprom_read_config(EEADR_MENU_ITEM(APF)) >> 8) & 0x1;
+                 sound_alarm   = (cfg.APF >> 8) & 0x1;
                  al_led_10     = LED_C;
                  al_led_1      = LED_h;
                  al_led_01     = LED_OFF;
@@ -42,6 +42,7 @@ int32_t  kd;       // Internal value for D action
 int32_t  pp;       // debug
 int16_t  yk_1;     // y[k-1]
 int16_t  yk_2;     // y[k-2]
+int16_t  pp_rem;   // remainder of pp in E-2 %, carried to the next u[k]
 bool     reverse_acting; // if Kc < 0, cooling-loop mode is enabled
 
 void init_pid(int16_t kc, uint16_t ti, uint16_t td, uint8_t ts, int16_t yk)
@@ -52,7 +53,7 @@ void init_pid(int16_t kc, uint16_t ti, uint16_t td, uint8_t ts, int16_t yk)
              ti: Ti parameter value in seconds ; controls I-action
              td: Td parameter value in seconds ; controls D-action
              ts: Ts parameter sample-time of pid-controller in seconds
-             yk: actual temperature value
+             yk: actual temperature value in E-2 °C
 
                    Kc.Ts
              ki =  -----   (for I-term)
@@ -79,6 +80,7 @@ void init_pid(int16_t kc, uint16_t ti, uint16_t td, uint8_t ts, int16_t yk)
    else         kd = (((int32_t)kcc * td) / ts);
    
    yk_2 = yk_1 = yk; // init. previous samples to current temperature
+   pp_rem = 0;
 } // init_pid()
 
 void pid_ctrl(int16_t yk, int16_t *uk, int16_t tset, bool pid_on)
@@ -88,9 +90,12 @@ void pid_ctrl(int16_t yk, int16_t *uk, int16_t tset, bool pid_on)
              on the setpoint, only on PV.
              This function should be called once every TS seconds.
   Variables:
-        yk : The input variable y[k] (= measured temperature in E-1 °C)
+        yk : The input variable y[k] (= measured temperature in E-2 °C)
        *uk : The pid-output variable u[k] [-1000..+1000] in E-1 %
       tset : The setpoint value w[k] for the temperature in E-1 °C
+             The terms are calculated in E-2 %, the remainder of the
+             division by 10 is carried to the next call, so that small
+             changes of y[k] are not lost.
   Returns  : No values are returned
   ------------------------------------------------------------------*/
 {
@@ -106,15 +111,21 @@ void pid_ctrl(int16_t yk, int16_t *uk, int16_t tset, bool pid_on)
     if (pid_on)
     {
         pp   = (int32_t)kc * (yk_1 - yk);               //  Kc.(y[k-1]-y[k])
-        pp  += (int32_t)ki * (tset - yk);               // (Kc.Ts/Ti).e[k]
+        pp  += (int32_t)ki * (tset * 10 - yk);          // (Kc.Ts/Ti).e[k]
         pp  += (int32_t)kd * ((yk_1 << 1) - yk - yk_2); // (Kc.Td/Ts).(2.y[k-1]-y[k]-y[k-2])
         if (reverse_acting) pp = -pp;                   // cooling loop!
-        *uk += (int16_t)pp;                             // u[k] = u[k-1] + ...
+        pp  += pp_rem;                                  // remainder of previous call
+        pp_rem = (int16_t)(pp % 10);
+        *uk += (int16_t)(pp / 10);                      // u[k] = u[k-1] + ..., E-2 % to E-1 %
         // limit u[k] to GMA_HLIM and GMA_LLIM
         if (*uk > GMA_HLIM)      *uk = GMA_HLIM;
         else if (*uk < GMA_LLIM) *uk = GMA_LLIM;
     } // if
-    else *uk = 0;
+    else 
+    {
+        *uk    = 0;
+        pp_rem = 0;
+    } // else
     yk_2  = yk_1; // y[k-2] = y[k-1]
     yk_1  = yk;   // y[k-1] = y[k]
 } // pid_ctrl()
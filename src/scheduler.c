@@ -23,186 +23,541 @@
 */ 
 #include "scheduler.h"
 
-task_struct task_list[MAX_TASKS]; // struct with all tasks
-uint8_t     max_tasks = 0;
+// Constant task data (function, delay, period), generated from TASK_DATA,
+// followed by the callback functions of all timers from TIMER_DATA
+const task_desc task_table[NO_OF_ENTRIES] = 
+{
+    TASK_DATA(TASK_DESC)
+    TIMER_DATA(TIMER_DESC)
+}; // task_table[]
+
+// Compile-time schedulability check of TASK_DATA, only a cheap guard: the
+// response-time of every task, with the initial delays, is computed by
+// tools/host/sched_rta. Tasks are not preempted, so in the worst case all 
+// tasks and timers are released at the same tick (whatever their initial 
+// delays) and a task has to wait for all others and the main-loop to finish.
+// With the Timer 2 interrupt taking TIM2_ISR_WCET usec. every msec., the
+// worst-case response-time is R = sum(WCET) / (1 - U_isr).
+// 1) The total CPU-utilization (tasks + interrupt) must be below 100 %.
+// 2) R must not exceed the period of any task, otherwise releases are lost.
+// A failing check gives a 'negative array size' compile error.
+// TASK_DATA can not be nested, so the sum of all WCETs is an enum constant
+// (and should fit in an int: 32 msec.).
+#define TASK_WCET_SUM(name, function, delay, period, wcet) + (wcet)
+#define TIMER_WCET_SUM(name, callback, wcet) + (wcet)
+#define TASK_UTIL(name, function, delay, period, wcet) + (((wcet) * 10L + (period) - 1) / (period))
+#define TASK_CHECK(name, function, delay, period, wcet) \
+        typedef char sched_check_##name[((SCHED_RESPONSE + 999L) / 1000L <= (period)) ? 1 : -1];
+enum sched_enum { SCHED_WCET_SUM = MAIN_LOOP_WCET TASK_DATA(TASK_WCET_SUM) TIMER_DATA(TIMER_WCET_SUM) }; // usec.
+#define SCHED_UTIL     (TIM2_ISR_WCET * 10L TASK_DATA(TASK_UTIL))  /* 0.01 % */
+#define SCHED_RESPONSE (SCHED_WCET_SUM * 1000L / (1000L - TIM2_ISR_WCET)) /* usec. */
+
+typedef char sched_check_util[(SCHED_UTIL < 10000L) ? 1 : -1];
+TASK_DATA(TASK_CHECK)
+
+#if defined(SCHED_DEBUG)
+// Task names, only needed for debugging
+#define TASK_NAME(name, function, delay, period, wcet) #name,
+const char * const task_name[NO_OF_TASKS] = 
+{
+    TASK_DATA(TASK_NAME)
+}; // task_name[]
+#endif
+
+task_struct task_list[NO_OF_ENTRIES]; // run-time data of all tasks and timers
+uint8_t     q_head    = NO_TASK;  // first task in the delta-queue
+uint32_t    sched_ticks = 0;      // free-running tick-counter, wraps after 49 days
+bool        sched_pending = false; // true = one or more tasks were released
+
+// Event handlers, generated from EVENT_DATA
+void (* const event_table[NO_OF_EVENTS])(uint8_t) = 
+{
+    EVENT_DATA(EVENT_HANDLER)
+}; // event_table[]
+
+// Single-producer single-consumer event queue: evt_head is only written by
+// post_event() (ISR), evt_tail only by dispatch_events() (main-loop).
+event            evt_queue[EVT_QUEUE_SIZE];
+volatile uint8_t evt_head = 0;    // next free entry in evt_queue[]
+volatile uint8_t evt_tail = 0;    // oldest posted entry in evt_queue[]
+uint8_t          evt_lost = 0;    // number of events dropped (queue full)
+
+#if defined(SCHED_STATS)
+/*-----------------------------------------------------------------------------
+  Purpose  : Read the free-running TIM1 counter, which runs at 1 MHz.
+             The MSB must be read first, the LSB is then latched.
+  Variables: -
+  Returns  : the TIM1 counter value in usec.
+  ---------------------------------------------------------------------------*/
+uint16_t stats_timer(void)
+{
+	uint16_t t = TIM1.CNTR.byteH;
+
+	t <<= 8;
+	t  |= TIM1.CNTR.byteL;
+	return t;
+} // stats_timer()
+#endif
 
 /*-----------------------------------------------------------------------------
   Purpose  : Run-time function for scheduler. Should be called from within
-             an ISR. This function goes through the task-list and decrements
-             eacht task counter. On time-out, the ready flag is set.
-  Variables: task_list[] structure
+             an ISR. All waiting tasks are kept in a delta-queue, ordered by
+             release time, where each Counter holds the number of ticks
+             relative to the previous task in the queue. Only the Counter of
+             the first task is decremented here, so the time needed does not
+             depend on the number of tasks. On time-out, the ready flag is set
+             and the task (plus all tasks due at the same tick) is removed
+             from the queue.
+  Variables: task_list[] structure, q_head, sched_ticks, sched_pending
   Returns  : -
   ---------------------------------------------------------------------------*/
 void scheduler_isr(void)
 {
-	uint8_t index = 0; // index in task_list struct
+	uint8_t index = q_head; // first task in the delta-queue
 
-	while(task_list[index].pFunction)
+	sched_ticks++;
+	if ((index != NO_TASK) && (--task_list[index].Counter == 0))
 	{
-		//First go through the initial delay
-		if(task_list[index].Delay > 0)
+		do
+		{   // Set the flag and remove the task from the queue
+			task_list[index].Status |= TASK_READY;
+			task_list[index].Release = sched_ticks;
+#if defined(SCHED_STATS)
+			task_list[index].ReleaseUs = stats_timer();
+#endif
+			index = task_list[index].Next;
+		} while ((index != NO_TASK) && (task_list[index].Counter == 0));
+		q_head        = index;
+		sched_pending = true;
+	} // if
+} // scheduler_isr()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Return the number of ticks until the next task is released.
+             Must be called with interrupts disabled.
+  Variables: q_head
+  Returns  : the number of ticks, 0xFFFFFFFF if no task is waiting
+  ---------------------------------------------------------------------------*/
+uint32_t sched_next_release(void)
+{
+	if (q_head == NO_TASK) return 0xFFFFFFFF;
+	return task_list[q_head].Counter;
+} // sched_next_release()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Add ticks that have passed while the scheduler was not running,
+             e.g. during halt mode. Every task that was due during these
+             ticks is released with the tick it was due as its release 
+             time, like scheduler_isr() would have done, so with
+             SCHED_DRIFT_FREE its next release stays on its grid. It is 
+             run by the next dispatch_tasks(), late.
+             Must be called with interrupts disabled.
+  Variables: ticks: the number of ticks that have passed
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void scheduler_advance(uint16_t ticks)
+{
+	uint8_t index = q_head; // first task in the delta-queue
+
+	while ((index != NO_TASK) && (task_list[index].Counter <= ticks))
+	{   // due during these ticks: release it at the tick it was due
+		ticks       -= (uint16_t)task_list[index].Counter;
+		sched_ticks += task_list[index].Counter;
+		do
 		{
-			task_list[index].Delay--;
-		} // if
-		else
-		{	//now we decrement the actual period counter 
-			task_list[index].Counter--;
-			if(task_list[index].Counter == 0)
-			{
-				//Set the flag and reset the counter;
-				task_list[index].Status |= TASK_READY;
-			} // if
-		} // else
-		index++;
+			task_list[index].Status |= TASK_READY;
+			task_list[index].Release = sched_ticks;
+#if defined(SCHED_STATS)
+			task_list[index].ReleaseUs = stats_timer(); // TIM1 stops in halt mode
+#endif
+			index = task_list[index].Next;
+		} while ((index != NO_TASK) && (task_list[index].Counter == 0));
+		q_head        = index;
+		sched_pending = true;
 	} // while
-} // scheduler_isr()
+	if (index != NO_TASK) task_list[index].Counter -= ticks;
+	sched_ticks += ticks;
+} // scheduler_advance()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Insert a task into the delta-queue, so that it is released after
+             a number of ticks. Tasks with the same release time keep their
+             order. Must be called with interrupts disabled.
+  Variables: index: index of the task in task_list[]
+             ticks: number of ticks from now (> 0)
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void enqueue_task(uint8_t index, uint32_t ticks)
+{
+	uint8_t *p = &q_head; // link that points to the next task
+
+	while ((*p != NO_TASK) && (task_list[*p].Counter <= ticks))
+	{
+		ticks -= task_list[*p].Counter;
+		p      = &task_list[*p].Next;
+	} // while
+	if (*p != NO_TASK) task_list[*p].Counter -= ticks; // relative to new task
+	task_list[index].Counter = ticks;
+	task_list[index].Next    = *p;
+	*p                       = index;
+} // enqueue_task()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Remove a task from the delta-queue. The ticks of the task are
+             added to the next task, so its release time does not change.
+             Must be called with interrupts disabled.
+  Variables: index: index of the task in task_list[]
+  Returns  : true = task was removed, false = task was not in the queue
+  ---------------------------------------------------------------------------*/
+bool dequeue_task(uint8_t index)
+{
+	uint8_t *p = &q_head; // link that points to the next task
+
+	while ((*p != NO_TASK) && (*p != index)) p = &task_list[*p].Next;
+	if (*p == NO_TASK) return false; // not found, e.g. released
+	*p = task_list[index].Next;
+	if (*p != NO_TASK) task_list[*p].Counter += task_list[index].Counter;
+	return true;
+} // dequeue_task()
 
 /*-----------------------------------------------------------------------------
   Purpose  : Run all tasks for which the ready flag is set. Should be called 
              from within the main() function, not from an interrupt routine!
-  Variables: task_list[] structure
+             A task that was released is put back into the delta-queue
+             after it has run. A disabled task is not run, but it stays
+             in the queue.
+             With SCHED_DRIFT_FREE, the next release is one period after 
+             the previous release, so dispatch latency and run-time do not
+             add up. If one or more releases were missed, Overruns is 
+             incremented and the next release stays on the original grid.
+             Without it, the next release is one period after the task
+             has finished.
+             Timers are run in the same way. A one-shot timer is not put
+             back into the queue, it is stopped after its callback has run.
+             A task or timer that is restarted by a function it calls
+             itself (start_timer(), set_task_time_period()) is already
+             back in the queue and is left alone.
+             Events posted by interrupt routines are handled after the
+             tasks, so the handlers see the results of tasks released
+             at the same tick.
+  Variables: task_list[] structure, sched_pending
   Returns  : -
   ---------------------------------------------------------------------------*/
 void dispatch_tasks(void)
 {
-	uint8_t  index = 0;
+	uint8_t  index;
+	uint32_t late; // ticks since release, wrap-around safe
+#if defined(SCHED_STATS)
+	uint16_t t1, t2; // start-time and run-time in usec.
+#endif
 
+	sched_pending = false; // set again by scheduler_isr() on a new release
 	//go through the active tasks
-	while(task_list[index].pFunction)
+	for (index = 0; index < NO_OF_ENTRIES; index++)
 	{
-		if((task_list[index].Status & (TASK_READY | TASK_ENABLED)) == (TASK_READY | TASK_ENABLED))
+		if (task_list[index].Status & TASK_READY)
 		{
-			task_list[index].pFunction(); // run the task
-			task_list[index].Status  &= ~TASK_READY; // reset the task when finished
-			task_list[index].Counter  = task_list[index].Period; // reset counter
+			if (task_list[index].Status & TASK_ENABLED)
+			{
+#if defined(SCHED_STATS)
+				t1 = stats_timer();
+				if (sched_ticks - task_list[index].Release > STATS_LATE_MAX)
+				     t2 = 0xFFFF; // TIM1 may have wrapped, saturate
+				else t2 = t1 - task_list[index].ReleaseUs; // start latency
+				if (t2 > task_list[index].Stats.LatencyMax) task_list[index].Stats.LatencyMax = t2;
+				task_table[index].pFunction(); // run the task
+				t2 = stats_timer() - t1; // run-time
+				task_list[index].Stats.Last = t2;
+				if (t2 < task_list[index].Stats.Min) task_list[index].Stats.Min = t2;
+				if (t2 > task_list[index].Stats.Max) task_list[index].Stats.Max = t2;
+#else
+				task_table[index].pFunction(); // run the task
+#endif
+			} // if
+			DISABLE_INTERRUPTS;
+			if (!(task_list[index].Status & TASK_READY))
+				; // restarted while running, already in the delta-queue
+			else if (task_list[index].Period == 0)
+				task_list[index].Status = 0; // one-shot timer has expired
+			else
+			{
+				task_list[index].Status &= ~TASK_READY; // reset the task when finished
+#if defined(SCHED_DRIFT_FREE)
+				late = sched_ticks - task_list[index].Release;
+				while (late >= task_list[index].Period)
+				{   // next release is already in the past
+					late -= task_list[index].Period;
+					task_list[index].Overruns++;
+				} // while
+				enqueue_task(index, task_list[index].Period - late); // next release
+#else
+				enqueue_task(index, task_list[index].Period); // next release
+#endif
+			} // else
+			ENABLE_INTERRUPTS;
 		} // if
-		index++;
-	} // while
-	//go to sleep till next tick!
+	} // for
+	dispatch_events(); // handle all events posted by interrupt routines
 } // dispatch_tasks()
 
 /*-----------------------------------------------------------------------------
-  Purpose  : Add a function to the task-list struct. Should be called upon
-  		     initialization.
-  Variables: task_ptr: pointer to function
-             delay   : initial delay in msec.
-             period  : period between two calls in msec.
-  Returns  : [NO_ERR, ERR_MAX_TASKS]
+  Purpose  : Post an event in the event queue. The handler of the event is 
+             called from dispatch_tasks() in the next main-loop iteration.
+             This function is the only writer of evt_head, so it should only
+             be called from an interrupt routine (or with interrupts 
+             disabled). The entry is filled in before evt_head is updated,
+             so dispatch_events() never sees a half-written entry.
+  Variables: type: event ID, e.g. EVT_DISP_TEST
+             data: optional data for the event handler
+  Returns  : error [NO_ERR, ERR_FULL]
   ---------------------------------------------------------------------------*/
-uint8_t add_task(void (*task_ptr)(), char *Name, uint16_t delay, uint16_t period)
+uint8_t post_event(uint8_t type, uint8_t data)
 {
-	uint8_t  index = 0;
-	uint16_t temp1 = (uint16_t)(delay  * TICKS_PER_SEC / 1000);
-	uint16_t temp2 = (uint16_t)(period * TICKS_PER_SEC / 1000);
+	uint8_t head = evt_head;
+	uint8_t next = (head + 1) & EVT_QUEUE_MASK;
 
-	if (max_tasks >= MAX_TASKS)
-		return ERR_MAX_TASKS;
-		
-	//go through the active tasks
-	if(task_list[index].Period != 0)
-	{
-		while(task_list[++index].Period != 0) ;
+	if (next == evt_tail)
+	{   // queue is full, event is lost
+		evt_lost++;
+		return ERR_FULL;
 	} // if
+	evt_queue[head].Type = type;
+	evt_queue[head].Data = data;
+	evt_head = next; // publish the entry
+	return NO_ERR;
+} // post_event()
 
-	if(task_list[index].Period == 0)
+/*-----------------------------------------------------------------------------
+  Purpose  : Call the handler of every event in the event queue, oldest first.
+             Should only be called from the main-loop. This function is the
+             only writer of evt_tail, so no interrupt locking is needed:
+             an 8-bit read or write is atomic on the STM8.
+  Variables: evt_queue[], evt_head, evt_tail
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void dispatch_events(void)
+{
+	uint8_t tail = evt_tail;
+
+	while (tail != evt_head)
 	{
-		task_list[index].pFunction    = task_ptr;       // Pointer to Function
-		task_list[index].Period       = temp2;          // Period in msec.
-		task_list[index].Counter      = temp2;	        // Countdown timer
-		task_list[index].Delay        = temp1;          // Initial delay before start
-		task_list[index].Status      |= TASK_ENABLED;   // Enable task by default
-		task_list[index].Status      &= ~TASK_READY;    // Task not ready to run
-		strncpy(task_list[index].Name, Name, NAME_LEN); // Name of Task
-		max_tasks++; // increase number of tasks
-	} // if
-	return NO_ERR;
-} // add_task()
+		if (evt_queue[tail].Type < NO_OF_EVENTS)
+		     event_table[evt_queue[tail].Type](evt_queue[tail].Data);
+		tail     = (tail + 1) & EVT_QUEUE_MASK;
+		evt_tail = tail; // release the entry
+	} // while
+} // dispatch_events()
 
+#if defined(SCHED_AUTO_PHASE)
 /*-----------------------------------------------------------------------------
-  Purpose  : Enable a task.
-  Variables: Name: Name of task to enable
-  Returns  : error [NO_ERR, ERR_NAME, ERR_EMPTY]
+  Purpose  : Returns the greatest common divisor of a and b (Euclid).
+  Variables: a, b: two periods in ticks
+  Returns  : gcd(a,b)
   ---------------------------------------------------------------------------*/
-uint8_t enable_task(char *Name)
+uint32_t gcd(uint32_t a, uint32_t b)
 {
-	uint8_t index = 0;
-	bool    found = false;
-	
-	//go through the active tasks
-	if(task_list[index].Period != 0)
+	uint32_t t;
+
+	while (b)
+	{
+		t = a % b;
+		a = b;
+		b = t;
+	} // while
+	return a;
+} // gcd()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Choose the phase of task id, given the phases of all tasks with
+             a lower id. Two tasks with periods Pi and Pj and phases oi and oj
+             release at the same tick once every while if oi = oj modulo 
+             gcd(Pi,Pj). The distance between their releases is at least the
+             circular distance d = (oi - oj) mod gcd(Pi,Pj). This function
+             tries every phase (up to MAX_PHASE) and takes the one where the
+             smallest slack, d (in usec.) minus the WCET of the other task,
+             is the largest. Greedy: tasks are placed in TASK_DATA order.
+  Variables: id   : ID of the task to place
+             phase: phases (ticks) of tasks 0..id-1
+  Returns  : the phase of task id in ticks, 0 <= phase < period
+  ---------------------------------------------------------------------------*/
+uint16_t auto_phase(uint8_t id, uint16_t *phase)
+{
+	uint32_t g[NO_OF_TASKS]; // gcd of period of task id and task j
+	uint32_t d;
+	uint16_t o, best = 0, max_o = MAX_PHASE;
+	int32_t  slack, min_slack, best_slack = -0x7FFFFFFFL;
+	uint8_t  j;
+
+	if (task_table[id].Period < MAX_PHASE) max_o = (uint16_t)task_table[id].Period;
+	for (j = 0; j < id; j++) g[j] = gcd(task_table[id].Period, task_table[j].Period);
+	for (o = 0; o < max_o; o++)
 	{
-		while ((task_list[index].Period != 0) && !found)
+		min_slack = 0x7FFFFFFFL;
+		for (j = 0; j < id; j++)
 		{
-			if (!strcmp(task_list[index].Name,Name))
-			{
-				task_list[index].Status |= TASK_ENABLED;
-				found = true;
-			} // if
-			index++;
-		} // while
-	} // if
-	else return ERR_EMPTY;
-	if (!found)
-	     return ERR_NAME;
-	else return NO_ERR;	
+			d = (o + g[j] - phase[j] % g[j]) % g[j];
+			if (d > g[j] - d) d = g[j] - d; // circular distance
+			if (d > MAX_PHASE) d = MAX_PHASE; // prevent overflow
+			slack = (int32_t)d * (1000000L / TICKS_PER_SEC) - task_table[j].Wcet;
+			if (slack < min_slack) min_slack = slack;
+		} // for
+		if (min_slack > best_slack)
+		{   // better phase found, on a tie the lowest phase is kept
+			best_slack = min_slack;
+			best       = o;
+		} // if
+	} // for
+	return best;
+} // auto_phase()
+#endif
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Put all tasks from task_table[] in the delta-queue. The first 
+             release of a task is after its initial delay plus its period.
+             With SCHED_AUTO_PHASE, the phase of every task is chosen by 
+             auto_phase() and the first release is the first tick at or after
+             its initial delay with that phase. This only lasts with 
+             SCHED_DRIFT_FREE, otherwise the phases drift with the run-times.
+             Should be called upon initialization, with interrupts disabled.
+  Variables: task_table[], task_list[] structure
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void init_tasks(void)
+{
+	uint8_t  id;
+#if defined(SCHED_AUTO_PHASE)
+	uint16_t phase[NO_OF_TASKS]; // phase of every task in ticks
+	uint32_t delay;
+#endif
+
+	for (id = 0; id < NO_OF_TASKS; id++)
+	{
+		task_list[id].Period    = task_table[id].Period; // Period in ticks
+		task_list[id].Status    = TASK_ENABLED;          // Enable task by default
+		task_list[id].Overruns  = 0;                     // No releases missed
+#if defined(SCHED_STATS)
+		task_list[id].Stats.Min = 0xFFFF;                // No run-time measured yet
+#endif
+#if defined(SCHED_AUTO_PHASE)
+		phase[id] = auto_phase(id, phase);
+		delay     = task_table[id].Delay;
+		delay    += (phase[id] + task_table[id].Period - delay % task_table[id].Period) 
+		             % task_table[id].Period;
+		if (delay == 0) delay = task_table[id].Period; // release at tick 0 is not possible
+		enqueue_task(id, delay);
+#else
+		enqueue_task(id, task_table[id].Delay + task_table[id].Period);
+#endif
+	} // for
+} // init_tasks()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Enable a task.
+  Variables: id: ID of task to enable, e.g. TASK_ADC
+  Returns  : error [NO_ERR, ERR_ID]
+  ---------------------------------------------------------------------------*/
+uint8_t enable_task(uint8_t id)
+{
+	if (id >= NO_OF_TASKS) return ERR_ID;
+	DISABLE_INTERRUPTS;
+	task_list[id].Status |= TASK_ENABLED;
+	ENABLE_INTERRUPTS;
+	return NO_ERR;
 } // enable_task()
 
 /*-----------------------------------------------------------------------------
   Purpose  : Disable a task.
-  Variables: Name: Name of task to disable
-  Returns  : error [NO_ERR, ERR_NAME, ERR_EMPTY]
+  Variables: id: ID of task to disable, e.g. TASK_ADC
+  Returns  : error [NO_ERR, ERR_ID]
   ---------------------------------------------------------------------------*/
-uint8_t disable_task(char *Name)
+uint8_t disable_task(uint8_t id)
 {
-	uint8_t index = 0;
-	bool    found = false;
-	
-	//go through the active tasks
-	if(task_list[index].Period != 0)
-	{
-		while ((task_list[index].Period != 0) && !found)
-		{
-			if (!strcmp(task_list[index].Name,Name))
-			{
-				task_list[index].Status &= ~TASK_ENABLED;
-				found = true;
-			} // if
-			index++;
-		} // while
-	} // if
-	else return ERR_EMPTY;
-	if (!found)
-	     return ERR_NAME;
-	else return NO_ERR;	
+	if (id >= NO_OF_TASKS) return ERR_ID;
+	DISABLE_INTERRUPTS;
+	task_list[id].Status &= ~TASK_ENABLED;
+	ENABLE_INTERRUPTS;
+	return NO_ERR;
 } // disable_task()
 
 /*-----------------------------------------------------------------------------
-  Purpose  : Set the time-period (msec.) of a task.
-  Variables: msec: the time in milliseconds
-             name: the name of the task to set the time for
-  Returns  : error [NO_ERR, ERR_NAME, ERR_EMPTY]
+  Purpose  : Set the time-period (msec.) of a task. A waiting task is 
+             restarted: its next release is one new period from now.
+             A task that is already released uses the new period from its
+             next release onwards.
+  Variables: Period: the time in milliseconds (> 0)
+             id    : ID of the task to set the time for, e.g. TASK_ADC
+  Returns  : error [NO_ERR, ERR_ID]
   ---------------------------------------------------------------------------*/
-uint8_t set_task_time_period(uint16_t Period, char *Name)
+uint8_t set_task_time_period(uint32_t Period, uint8_t id)
 {
-	uint8_t index = 0;
-	bool    found = false;
-	
-	//go through the active tasks
-	if(task_list[index].Period != 0)
-	{
-		while ((task_list[index].Period != 0) && !found)
-		{
-			if (!strcmp(task_list[index].Name,Name))
-			{
-				task_list[index].Period = (uint16_t)(Period * TICKS_PER_SEC / 1000);
-				found = true;
-			} // if
-			index++;
-		} // while
+	if (id >= NO_OF_TASKS) return ERR_ID;
+	DISABLE_INTERRUPTS;
+	task_list[id].Period = MSEC_TO_TICKS(Period);
+	if (dequeue_task(id)) 
+	{   // restart the period
+		task_list[id].Release = sched_ticks;
+		enqueue_task(id, task_list[id].Period);
 	} // if
-	else return ERR_EMPTY;
-	if (!found)
-	     return ERR_NAME;
-	else return NO_ERR;	
+	ENABLE_INTERRUPTS;
+	return NO_ERR;
 } // set_task_time_period()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : Start (or restart) a timer. Its callback function is called 
+             from dispatch_tasks() once the delay has passed and, if period
+             is not 0, every period after that. A timer that is already 
+             running is restarted with the new delay and period.
+  Variables: id    : ID of the timer, e.g. TMR_COOL_DLY
+             delay : time in msec. until the first call (0 = next tick)
+             period: time in msec. between calls, 0 = one-shot timer
+  Returns  : error [NO_ERR, ERR_ID]
+  ---------------------------------------------------------------------------*/
+uint8_t start_timer(uint8_t id, uint32_t delay, uint32_t period)
+{
+	uint32_t ticks = MSEC_TO_TICKS(delay);
+
+	if ((id < NO_OF_TASKS) || (id >= NO_OF_ENTRIES)) return ERR_ID;
+	if (ticks == 0) ticks = 1; // release at next tick
+	DISABLE_INTERRUPTS;
+	dequeue_task(id);
+	task_list[id].Period  = MSEC_TO_TICKS(period);
+	task_list[id].Release = sched_ticks;
+	task_list[id].Status  = TASK_ENABLED; // clears TASK_READY
+	enqueue_task(id, ticks);
+	ENABLE_INTERRUPTS;
+	return NO_ERR;
+} // start_timer()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Stop a timer. Its callback function is not called anymore, 
+             also not when the timer has expired but has not run yet.
+  Variables: id: ID of the timer, e.g. TMR_COOL_DLY
+  Returns  : error [NO_ERR, ERR_ID]
+  ---------------------------------------------------------------------------*/
+uint8_t cancel_timer(uint8_t id)
+{
+	if ((id < NO_OF_TASKS) || (id >= NO_OF_ENTRIES)) return ERR_ID;
+	DISABLE_INTERRUPTS;
+	dequeue_task(id);
+	task_list[id].Status = 0; // not running, clears TASK_READY
+	ENABLE_INTERRUPTS;
+	return NO_ERR;
+} // cancel_timer()
+
+#if defined(SCHED_STATS)
+/*-----------------------------------------------------------------------------
+  Purpose  : Get a copy of the run-time statistics of a task.
+  Variables: id: ID of the task, e.g. TASK_ADC
+             p : pointer to struct that receives the statistics
+  Returns  : error [NO_ERR, ERR_ID]
+  ---------------------------------------------------------------------------*/
+uint8_t get_task_stats(uint8_t id, task_stats *p)
+{
+	if (id >= NO_OF_TASKS) return ERR_ID;
+	DISABLE_INTERRUPTS;
+	*p          = task_list[id].Stats;
+	p->Overruns = task_list[id].Overruns;
+	ENABLE_INTERRUPTS;
+	return NO_ERR;
+} // get_task_stats()
+#endif
@@ -25,36 +25,134 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include <string.h>
+#include "config.h"
+#include "stm8as.h"
+#include "stc1000p.h"
 
-#define MAX_TASKS	  (4)
-#define MAX_MSEC      (60000)
 #define TICKS_PER_SEC (1000L)
-#define NAME_LEN         (12) 
+
+// Convert msec. to ticks without overflow, for periods up to 49 days
+#define MSEC_TO_TICKS(ms) ((uint32_t)(ms) / 1000 * TICKS_PER_SEC + (uint32_t)(ms) % 1000 * TICKS_PER_SEC / 1000)
+
+#define NO_TASK       (0xFF)
+
+// SCHED_AUTO_PHASE: largest phase-offset (ticks) tried for a task
+#define MAX_PHASE     (1000)
 
 #define TASK_READY    (0x01)
 #define TASK_ENABLED  (0x02)
 
 #define NO_ERR        (0x00)
-#define ERR_NAME      (0x04)
-#define ERR_EMPTY     (0x05)
-#define ERR_MAX_TASKS    (5)
+#define ERR_ID        (0x04)
+#define ERR_FULL      (0x05)
 
-typedef struct _task_struct
+// Size of the event queue, must be a power of 2. One entry is always kept
+// free to tell a full queue from an empty one.
+#define EVT_QUEUE_SIZE (8)
+#define EVT_QUEUE_MASK (EVT_QUEUE_SIZE - 1)
+
+// Task IDs generated from TASK_DATA in stc1000p.h: TASK_ADC, TASK_STD, ...
+#define TASK_ENUM(name, function, delay, period, wcet) TASK_##name,
+enum task_enum 
+{
+    TASK_DATA(TASK_ENUM)
+    NO_OF_TASKS
+}; // task_enum
+
+// Timer IDs generated from TIMER_DATA in stc1000p.h: TMR_COOL_DLY, ...
+// Timers are kept in task_list[] after the tasks, so their IDs follow the
+// task IDs. NO_OF_ENTRIES is the total number of tasks and timers.
+#define TIMER_ENUM(name, callback, wcet) TMR_##name,
+enum timer_enum 
+{
+    TMR_BASE = NO_OF_TASKS - 1,
+    TIMER_DATA(TIMER_ENUM)
+    NO_OF_ENTRIES
+}; // timer_enum
+
+// Constant part of a task, stored in flash
+typedef struct _task_desc
 {
 	void     (*pFunction)(void); // Function pointer
-	char     Name[NAME_LEN];  // Task name
-	uint16_t Period;          // Period between 2 calls in msec.
-	uint16_t Delay;           // Initial delay before Counter starts in msec.
-	uint16_t Counter;         // Running counter, is init. from Period
+	uint32_t Delay;           // Initial delay before the first period in ticks
+	uint32_t Period;          // Default period between 2 calls in ticks
+	uint16_t Wcet;            // Worst-case execution time in usec.
+} task_desc;
+
+// Task table data generator
+#define TASK_DESC(name, function, delay, period, wcet) \
+        { function, MSEC_TO_TICKS(delay), MSEC_TO_TICKS(period), (wcet) },
+
+// Timer table data generator, delay and period are set by start_timer()
+#define TIMER_DESC(name, callback, wcet) { callback, 0, 0, (wcet) },
+
+// TIM1 wraps after 65.5 msec.: a start latency of more ticks than this can
+// not be measured, it is saturated to 0xFFFF. This happens after an overrun
+// or an active-halt (TIM1 stops in halt mode) that ends after the release.
+#define STATS_LATE_MAX (0xFFFFL / (1000000L / TICKS_PER_SEC) - 1) /* ticks */
+
+typedef struct _task_stats
+{
+	uint16_t Last;            // Last run-time in usec.
+	uint16_t Min;             // Minimum run-time in usec.
+	uint16_t Max;             // Maximum run-time in usec.
+	uint16_t LatencyMax;      // Maximum time between release and start in usec., 0xFFFF = STATS_LATE_MAX or more
+	uint16_t Overruns;        // Number of releases missed
+} task_stats;
+
+// Run-time part of a task, stored in RAM
+typedef struct _task_struct
+{
+	uint32_t Period;          // Period between 2 calls in ticks, 0 = one-shot timer
+	uint32_t Counter;         // Ticks to go after the previous task in the delta-queue
+	uint32_t Release;         // Tick-count at the last release
+	uint16_t Overruns;        // Number of releases missed
+	uint8_t  Next;            // Index of next task in the delta-queue, NO_TASK = last
 	uint8_t	 Status;          // bit 1: 1=enabled ; bit 0: 1=ready to run
+#if defined(SCHED_STATS)
+	uint16_t ReleaseUs;       // TIM1 counter at the last release
+	task_stats Stats;         // Run-time statistics, Stats.Overruns is not used
+#endif
 } task_struct;
 
+// Event IDs generated from EVENT_DATA in stc1000p.h: EVT_DISP_TEST, ...
+#define EVENT_ENUM(name, handler) EVT_##name,
+enum event_enum 
+{
+    EVENT_DATA(EVENT_ENUM)
+    NO_OF_EVENTS
+}; // event_enum
+
+// Event handler table data generator
+#define EVENT_HANDLER(name, handler) handler,
+
+// Event record in the event queue
+typedef struct _event
+{
+	uint8_t Type;             // Event ID, e.g. EVT_DISP_TEST
+	uint8_t Data;             // Optional data for the event handler
+} event;
+
 void    scheduler_isr(void);  // run-time function for scheduler
 void    dispatch_tasks(void); // run all tasks that are ready
-uint8_t add_task(void (*task_ptr)(), char *Name, uint16_t delay, uint16_t period);
-uint8_t set_task_time_period(uint16_t Period, char *Name);
-uint8_t enable_task(char *Name);
-uint8_t disable_task(char *Name);
+void    enqueue_task(uint8_t index, uint32_t ticks); // insert task in delta-queue
+bool    dequeue_task(uint8_t index); // remove task from delta-queue
+uint32_t sched_next_release(void);      // ticks until next release
+void    scheduler_advance(uint16_t ticks); // add ticks that passed without scheduler_isr()
+void    init_tasks(void);     // put all tasks of TASK_DATA in the delta-queue
+uint8_t set_task_time_period(uint32_t Period, uint8_t id);
+uint8_t enable_task(uint8_t id);
+uint8_t disable_task(uint8_t id);
+uint8_t start_timer(uint8_t id, uint32_t delay, uint32_t period);
+uint8_t cancel_timer(uint8_t id);
+uint8_t post_event(uint8_t type, uint8_t data); // from ISR context only
+void    dispatch_events(void);  // run the handlers of all posted events
+#if defined(SCHED_STATS)
+uint16_t stats_timer(void);     // TIM1 counter in usec.
+uint8_t get_task_stats(uint8_t id, task_stats *p);
+#endif
+#if defined(SCHED_DEBUG)
+extern const char * const task_name[];
+#endif
 
 #endif
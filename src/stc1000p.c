@@ -36,16 +36,24 @@ bool      ad_err1 = false; // used for adc range checking
 bool      ad_err2 = false; // used for adc range checking
 uint8_t   probe2  = 0;     // cached flag indicating whether 2nd probe is active
 bool      show_sa_alarm = false; // true = display alarm
+bool      sa_blinking   = false; // true = TMR_ALM_BLINK is running
 bool      sound_alarm   = false; // true = sound alarm
+#if defined(OVBSC)
 bool      ad_ch   = false; // used in adc_task()
-uint16_t  ad_ntc1 = (512L << FILTER_SHIFT);
-uint16_t  ad_ntc2 = (512L << FILTER_SHIFT);
+#endif
+uint32_t  ad_ntc1 = AD_MID_SCALE; // IIR filter of NTC probe 1, 16-bit full-scale << FILTER_SHIFT
+uint32_t  ad_ntc2 = AD_MID_SCALE; // IIR filter of NTC probe 2
+uint8_t   ad_shift1 = FILTER_SHIFT; // time-constant of ad_ntc1, see ad_filter()
+uint8_t   ad_shift2 = FILTER_SHIFT; // time-constant of ad_ntc2
 int16_t   temp_ntc1;         // The temperature in E-1 C from NTC probe 1
+int16_t   temp_ntc1_e2;      // The temperature in E-2 C from NTC probe 1, for the PID controller
 int16_t   temp_ntc2;         // The temperature in E-1 C from NTC probe 2
 uint8_t   mpx_nr = 0;        // Used in multiplexer() function
 // When in SWIM Debug Mode, PORT_D1/SWIM needs to be disabled (= no IO)
 uint8_t   portd_leds;        // Contains define PORTD_LEDS
-uint8_t   portb, portc, portd, b;// Needed for save_display_state() and restore_display_state()
+uint8_t   b;                 // Needed for AWU_ISR()
+volatile uint8_t keys = 0;   // buttons read in the blank slot of multiplexer(): 3..0 = UP, DOWN, PWR, S
+volatile bool    keys_req = true; // true = multiplexer() reads the buttons in its next blank slot
 int16_t   pwr_on_tmr = 1000;     // Needed for 7-segment display test
 
 // External variables, defined in other files
@@ -56,12 +64,27 @@ extern uint8_t sensor2_selected; // DOWN button pressed < 3 sec. shows 2nd tempe
 extern bool    minutes;          // timing control: false = hours, true = minutes
 extern bool    menu_is_idle;     // No menus in STD active
 extern bool    fahrenheit;       // false = Celsius, true = Fahrenheit
-extern uint16_t cooling_delay;   // Initial cooling delay
-extern uint16_t heating_delay;   // Initial heating delay
 extern int16_t  setpoint;        // local copy of SP variable
 extern int16_t  kc;              // Parameter value for Kc value in %/C
 extern uint8_t  ts;              // Parameter value for sample time [sec.]
 extern int16_t  pid_out;         // Output from PID controller in E-1 %
+extern bool     sched_pending;   // true = one or more tasks were released
+extern volatile uint8_t evt_head, evt_tail; // event queue of the scheduler
+extern volatile uint8_t adc_state; // ADC_IDLE..ADC_BUSY, see temp.c
+extern uint8_t          eep_q_cnt; // number of EEPROM blocks waiting to be programmed, see eep.c
+extern uint8_t          eep_jstate; // EEP_J_IDLE = no EEPROM transaction waiting, see eep.c
+
+// adc_done() passes the calibration points of a probe to temp_correction() as 
+// an array: the menu-items C0, C5 and C1 (C02, C52 and C12) must be consecutive.
+#if defined(OVBSC)
+typedef char adc_check_cal[((C5 == C0 + 1) && (C1 == C0 + 2)) ? 1 : -1];
+#else
+typedef char adc_check_cal[((C5 == C0 + 1) && (C1 == C0 + 2) && (C52 == C02 + 1) && (C12 == C02 + 2)) ? 1 : -1];
+#endif
+extern adc_sum_t        adc_sum[]; // sum of ADC_AVG conversion results per probe
+#if defined(SCHED_STATS)
+extern uint16_t         adc_t0;   // TIM1 counter when the display was turned off
+#endif
 
 #if defined(OVBSC)
 extern uint8_t  prg_state;
@@ -72,51 +95,21 @@ extern bool     ovbsc_run_prg;
 extern uint16_t countdown;
 #endif
 
-/*-----------------------------------------------------------------------------
-  Purpose  : This routine saves the current state of the 7-segment display.
-             This is necessary since the buttons, but also the AD-channels,
-             share the same GPIO bits.
-             It uses the global variables portb, portc and portd.
-  Variables: -
-  Returns  : -
-  ---------------------------------------------------------------------------*/
-void save_display_state(void)
-{
-    // Save registers that interferes with LEDs and AD-channels
-    portb   = PORT_B.IDR.byte & (CC_10 | CC_1); // Common-Cathode for 10s and 1s
-    portc   = PORT_C.IDR.byte & BUTTONS;        // LEDs connected to buttons 
-    // Common-Cathode for 0.1s and extras and AD-channels AIN4 and AIN3
-    portd   = PORT_D.IDR.byte & (CC_01 | CC_e | AD_CHANNELS); 
-    PORT_B.ODR.byte |= (CC_10 | CC_1);  // Disable common-cathode for 10s and 1s
-    PORT_D.ODR.byte |= (CC_01 | CC_e);  // Disable common-cathode for 0.1s and extras
-} // save_display_state()
-
-/*-----------------------------------------------------------------------------
-  Purpose  : This routine restores the current state of the 7-segment display.
-             This is necessary since the buttons, but also the AD-channels,
-             share the same GPIO bits.
-             It uses the global variables portb, portc and portd.
-  Variables: -
-  Returns  : -
-  ---------------------------------------------------------------------------*/
-void restore_display_state(void)
-{
-    PORT_D.ODR.byte &= ~(CC_01 | CC_e | AD_CHANNELS); // init. CC_01, CC_e and AD-channels
-    PORT_D.ODR.byte |= portd;                         // restore values for PORTD
-    PORT_C.ODR.byte &= ~BUTTONS;                      // init. buttons
-    PORT_C.ODR.byte |= portc;                         // restore values for PORTC
-    PORT_B.ODR.byte &= ~(CC_10 | CC_1);               // init. CC_10 and CC_1
-    PORT_B.ODR.byte |= portb;                         // restore values for PORTB
-} // restore_display_state()
-
 /*-----------------------------------------------------------------------------
   Purpose  : This routine multiplexes the 4 segments of the 7-segment displays.
              It runs at 1 kHz, so there's a full update after every 4 msec.
+             The buttons and the AD-channels share GPIO bits with the LEDs.
+             When read_buttons() or adc_task() has a request, a 5th blank 
+             slot is added, with all LEDs off. In this slot, the buttons are
+             read and the AD-channels are made inputs for adc_start(), so 
+             no LED state needs to be saved and no interrupts are disabled.
   Variables: -
   Returns  : -
   ---------------------------------------------------------------------------*/
 void multiplexer(void)
 {
+    uint8_t i;
+    
     PORT_C.ODR.byte    &= ~PORTC_LEDS;    // Clear LEDs
     PORT_D.ODR.byte    &= ~portd_leds;    // Clear LEDs
     PORT_B.ODR.byte    |= (CC_10 | CC_1); // Disable common-cathode for 10s and 1s
@@ -150,11 +143,32 @@ void multiplexer(void)
             PORT_D.ODR.byte |= ((led_e << 1) & portd_leds); // Update PORT_D3..PORT_D1
             PORT_D.ODR.byte &= ~CC_e;     // Enable common-cathode for extras
             ALARM_OFF;
-        default: // FALL-THROUGH (less code-size)
+            if (keys_req || (adc_state == ADC_REQUEST)) 
+                 mpx_nr = 4; // blank slot next
+            else mpx_nr = 0;
+            break;
+        default: // blank slot: all common-cathodes and LEDs are off
+            if (keys_req)
+            {   // Read the buttons
+                PORT_C.DDR.byte &= ~BUTTONS;  // Set PORT_C6..PORT_C3 as inputs
+                PORT_C.CR1.byte |=  BUTTONS;  // Enable pull-ups for PORT_C6..PORT_C3 (Rpu is approx 45k)
+                for (i = 0; i < 10; i++) ;    // give port a bit of time
+                i = ((PORT_C.IDR.byte & BUTTONS) >> 3); // 3..0: UP, DOWN, PWR, S
+                keys = (i ^ 0x0F) & 0x0F;     // Invert buttons (0 = pressed)
+                PORT_C.DDR.byte |= BUTTONS;   // Set PORT_C6..PORT_C3 to outputs again (Push-Pull)
+                keys_req = false;
+            } // if
+            if (adc_state == ADC_REQUEST)
+            {   // AD-channels are inputs until adc_isr() is done, display stays off
+                PORT_D.DDR.byte &= ~AD_CHANNELS; // Set PORT_D3 (AIN4) and PORT_D2 (AIN3) to inputs
+                PORT_D.CR1.byte &= ~AD_CHANNELS; // Set to floating-inputs (required by ADC)  
+                adc_state = ADC_SETTLE;          // adc_start() at the next msec.
+#if defined(SCHED_STATS)
+                adc_t0 = stats_timer();          // adc_isr() measures the display-off time
+#endif
+            } // if
             mpx_nr = 0;
             break;
-            //mpx_nr = 0;
-            //break;
     } // switch            
 } // multiplexer()
 
@@ -168,21 +182,77 @@ ISR_HANDLER(TIM2_UPD_ISR, __TIM2_UPD_VECTOR__)
 {
     scheduler_isr();  // Run scheduler interrupt function
     if (!pwr_on)
+#if defined(SCHED_ACTIVE_HALT)
+    {   // Display is switched off, the uC is in active-halt most of the time
+        led_10 = led_1 = led_01 = led_e = LED_OFF;
+        pwr_on_tmr = 2000; // 2 seconds
+    } // if
+#else
     {   // Display OFF on dispay
 	led_10     = LED_O;
 	led_1      = led_01 = LED_F;
         led_e      = LED_OFF;
         pwr_on_tmr = 2000; // 2 seconds
     } // if
+#endif
     else if (pwr_on_tmr > 0)
     {	// 7-segment display test for 2 seconds
-        pwr_on_tmr--;
+        if (--pwr_on_tmr == 0) post_event(EVT_DISP_TEST, 0);
         led_10 = led_1 = led_01 = led_e = LED_ON;
     } // else if
-    multiplexer();    // Run multiplexer for Display and Keys
+    // AD-channels are inputs from ADC_SETTLE, display stays off until adc_isr() is done
+    if (adc_state == ADC_SETTLE)   adc_start();   // input signal has settled for 1 msec.
+    else if (adc_state != ADC_BUSY) multiplexer(); // Run multiplexer for Display and Keys
     TIM2.SR1.reg.UIF = 0; // Reset the interrupt otherwise it will fire again straight away.
 } // TIM2_UPD_OVF_IRQHandler()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : This is the interrupt routine for the ADC end-of-conversion.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+ISR_HANDLER(ADC_ISR, __ADC_VECTOR__)
+{
+    adc_isr(); // add result and start next conversion, see temp.c
+} // ADC_ISR()
+
+#if defined(SCHED_ACTIVE_HALT)
+/*-----------------------------------------------------------------------------
+  Purpose  : This is the interrupt routine for the Auto Wake-Up unit. It only
+             wakes the uC from active-halt mode.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+ISR_HANDLER(AWU_ISR, __AWU_VECTOR__)
+{
+    b = AWU.CSR.byte; // Reading CSR clears the AWUF flag
+} // AWU_ISR()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine puts the uC in active-halt mode for AWU_MSEC msec.
+             All clocks except the LSI are stopped, so Timer 2 and with it
+             the scheduler and the display multiplexer stop too. The display
+             is switched off and the halted time is added to the scheduler 
+             afterwards. Must be called with interrupts disabled.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void active_halt(void)
+{
+    PORT_B.ODR.byte    |= (CC_10 | CC_1); // Disable common-cathode for 10s and 1s
+    PORT_D.ODR.byte    |= (CC_01 | CC_e); // Disable common-cathode for 0.1s and extras
+    ALARM_OFF;
+    AWU.APR.reg.APR     = 0x3E;  // APRDIV = 64
+    AWU.TBR.reg.AWUTB   = 0x08;  // 2^7 * 64 / 128 kHz = 64 msec.
+    AWU.CSR.reg.AWUEN   = 1;     // Enable Auto Wake-Up
+    FLASH.CR1.reg.AHALT = 1;     // Power-down the Flash during active-halt
+    ENTER_HALT;                  // Also enables interrupts, AWU_ISR() wakes us
+    DISABLE_INTERRUPTS;
+    AWU.CSR.reg.AWUEN   = 0;     // Disable Auto Wake-Up
+    scheduler_advance(AWU_MSEC * TICKS_PER_SEC / 1000);
+} // active_halt()
+#endif
+
 /*-----------------------------------------------------------------------------
   Purpose  : This routine initialises the system clock to run at 16 MHz.
              It uses the internal HSI oscillator.
@@ -221,6 +291,23 @@ void setup_timer2(void)
     TIM2.CR1.reg.CEN = 1;     //  Finally enable the timer
 } // setup_timer2()
 
+#if defined(SCHED_STATS)
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine initialises Timer 1 as a free-running counter at
+             1 MHz, used by the scheduler to measure task timing.
+             16 MHz / 16 = 1 MHz
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void setup_timer1(void)
+{
+    TIM1.PSCR.byteH   = 0x00;  //  High byte of prescaler - 1
+    TIM1.PSCR.byteL   = 0x0F;  //  Low  byte of prescaler - 1 = 15
+    TIM1.EGR.reg.UG  = 1;     //  Generate update event to load prescaler
+    TIM1.CR1.reg.CEN = 1;     //  Enable the timer, ARR = 0xFFFF after reset
+} // setup_timer1()
+#endif
+
 /*-----------------------------------------------------------------------------
   Purpose  : This routine initialises all the GPIO pins of the STM8 uC.
              See stc1000p.h for a detailed description of all pin-functions.
@@ -244,47 +331,68 @@ void setup_output_ports(void)
 } // setup_output_ports()
 
 /*-----------------------------------------------------------------------------
-  Purpose  : This task is called every 500 msec. and processes the NTC 
-             temperature probes from NTC1 (PORT_D3/AIN4) and NTC2 (PORT_D2/AIN3)
+  Purpose  : This task is called every 500 msec. and starts the conversions
+             of the NTC temperature probes from NTC1 (PORT_D3/AIN4) and 
+             NTC2 (PORT_D2/AIN3). Both probes are converted alternately in
+             the same time-window, with half the number of conversions each,
+             so the display is not off longer than for one probe. 
+             It only sets a request: multiplexer() makes the AD-channels 
+             inputs in its blank slot and the Timer 2 interrupt starts the
+             conversions one msec. later. They run in the background 
+             (adc_isr()), the results are processed by adc_done().
   Variables: -
   Returns  : -
   ---------------------------------------------------------------------------*/
 void adc_task(void)
 {
-  uint16_t temp;
-  uint8_t  i;
+  if (adc_state != ADC_IDLE) return; // previous conversions not finished yet
+#if defined(OVBSC)
+  ad_ch = !ad_ch;
+  if (!ad_ch) return;   // NTC probe 1 only, every second
+#endif
+  adc_state = ADC_REQUEST; // multiplexer() and the Timer 2 interrupt do the rest
+} // adc_task()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Event handler for EVT_ADC_DONE, posted by adc_isr() when all 
+             conversions are done. For every probe, it scales the sum of
+             conversions into a 16-bit full-scale value, filters it with
+             ad_filter() (after the median-of-3 prefilter if ADC_MEDIAN is set), 
+             converts it into a temperature in E-2 C and corrects it with 
+             the calibration curve (C0..C1) and the offset (tc) of the probe.
+  Variables: data: not used
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void adc_done(uint8_t data)
+{
+  uint16_t temp; // ADC-value, 16-bit full-scale
+  int16_t  t;    // temperature in E-2 C
   
-  // Save registers that interferes with LED's and disable common-cathodes
-  DISABLE_INTERRUPTS;      // Disable interrups while reading buttons
-  save_display_state();       // Save current state of 7-segment displays
-  PORT_D.DDR.byte &= ~AD_CHANNELS;     // Set PORT_D3 (AIN4) and PORT_D2 (AIN3) to inputs
-  PORT_D.CR1.byte &= ~AD_CHANNELS;     // Set to floating-inputs (required by ADC)  
-  for (i = 0; i < 200; i++) ; // Disable to let input signal settle
-  if (ad_ch)
-  {  // Process NTC probe 1
-     temp       = read_adc(AD_NTC1);
-     ad_ntc1    = ((ad_ntc1 - (ad_ntc1 >> FILTER_SHIFT)) + temp);
-     temp_ntc1  = ad_to_temp(ad_ntc1,&ad_err1);
-     temp_ntc1 += eeprom_read_config(EEADR_MENU_ITEM(tc));
-  } // if
+  (void)data;
+  // Process NTC probe 1
+  temp = ADC_SUM_TO_FS(adc_sum[0]);
+#if defined(ADC_MEDIAN)
+  temp = median3(0, temp); // reject single spikes
+#endif
+  ad_filter(&ad_ntc1, &ad_shift1, temp);
+  t            = ad_to_temp((uint16_t)(ad_ntc1 >> FILTER_SHIFT),&ad_err1);
+  t           += 10 * (temp_correction(t / 10, &cfg.C0) + 
+                       cfg.tc);
+  temp_ntc1_e2 = t;
+  temp_ntc1    = E2_TO_E1(t);
 #if !(defined(OVBSC))
-  else
-  {  // Process NTC probe 2
-     temp       = read_adc(AD_NTC2);
-     ad_ntc2    = ((ad_ntc2 - (ad_ntc2 >> FILTER_SHIFT)) + temp);
-     temp_ntc2  = ad_to_temp(ad_ntc2,&ad_err2);
-     temp_ntc2 += eeprom_read_config(EEADR_MENU_ITEM(tc2));
-  } // else
+  // Process NTC probe 2, converted in the same time-window
+  temp = ADC_SUM_TO_FS(adc_sum[1]);
+#if defined(ADC_MEDIAN)
+  temp = median3(1, temp);
 #endif
-  ad_ch = !ad_ch;
-
-  // Since the ADC disables GPIO pins automatically, these need
-  // to be set to GPIO output pins again.
-  PORT_D.DDR.byte  |= AD_CHANNELS;  // Set PORT_D3 (AIN4) and PORT_D2 (AIN3) as outputs again
-  PORT_D.CR1.byte  |= AD_CHANNELS;  // Set PORT_D3 (AIN4) and PORT_D2 (AIN3) to Push-Pull again
-  restore_display_state(); // Restore state of 7-segment displays
-  ENABLE_INTERRUPTS;    // Re-enable Interrupts
-} // adc_task()
+  ad_filter(&ad_ntc2, &ad_shift2, temp);
+  t            = ad_to_temp((uint16_t)(ad_ntc2 >> FILTER_SHIFT),&ad_err2);
+  t           += 10 * (temp_correction(t / 10, &cfg.C02) + 
+                       cfg.tc2);
+  temp_ntc2    = E2_TO_E1(t);
+#endif
+} // adc_done()
 
 /*-----------------------------------------------------------------------------
   Purpose  : This task is called every 100 msec. and creates a slow PWM signal
@@ -347,6 +455,92 @@ void std_task(void)
     pid_to_time();  // Make Slow-PWM signal and send to S3 output-port
 } // std_task()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : This function shows the temperature (or counter / pid-output)
+             on the 7-segment display. Called by ctrl_task() and 
+             disp_test_done() when the menu is idle.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void show_temperature(void)
+{
+#if defined(OVBSC)
+    if (ovbsc_run_prg && (prg_state == PRG_BOIL) || (prg_state == PRG_WAIT_STRIKE))
+         value_to_led(countdown,LEDS_INT);
+    else value_to_led(temp_ntc1,LEDS_TEMP);
+#else
+    led_e &= ~LED_POINT; // LED in middle, does not seem to work
+    switch (sensor2_selected)
+    {
+        case 0: value_to_led(temp_ntc1,LEDS_TEMP); 
+                break;
+        case 1: value_to_led(temp_ntc2,LEDS_TEMP); 
+                led_e |= LED_POINT;
+                break;
+        case 2: value_to_led(pid_out  ,LEDS_PERC) ; 
+                break;
+    } // switch
+#endif
+} // show_temperature()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Event handler for EVT_DISP_TEST, posted by the Timer 2 interrupt
+             when the 7-segment display test has finished. It shows the 
+             temperature right away instead of waiting for ctrl_task().
+  Variables: data: not used
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void disp_test_done(uint8_t data)
+{
+    (void)data;
+    if (menu_is_idle && !sound_alarm) show_temperature();
+} // disp_test_done()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Callback of timer TMR_ALM_BLINK, which runs every second while
+             the alarm sounds. When the menu is idle, the display alternates
+             between the alarm text and the temperature, independent of the
+             release of ctrl_task().
+  Variables: show_sa_alarm
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void alarm_blink(void)
+{
+    show_sa_alarm = sound_alarm && !show_sa_alarm; // off when silenced
+    if (!menu_is_idle) return;
+    if (show_sa_alarm)
+    {
+#if defined(OVBSC)
+        led_10 = al_led_10;
+        led_1  = al_led_1;
+        led_01 = al_led_01;
+#else
+        led_10 = LED_A;
+        led_1  = LED_L;
+        led_01 = LED_d;
+#endif
+    } 
+    else show_temperature();
+} // alarm_blink()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Start or stop the blinking of the alarm text: timer TMR_ALM_BLINK
+             runs every second while blink is true. Called by ctrl_task().
+  Variables: blink: true = alarm text blinks on the display
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void set_alarm_blink(bool blink)
+{
+    if (blink == sa_blinking) return; // no change
+    sa_blinking = blink;
+    if (blink) start_timer(TMR_ALM_BLINK, 0, 1000); // alarm text on next tick
+    else
+    {
+        cancel_timer(TMR_ALM_BLINK);
+        show_sa_alarm = false;
+    } // else
+} // set_alarm_blink()
+
 #if defined(OVBSC)
 /*-----------------------------------------------------------------------------
   Purpose  : This task is called every second and contains the main control
@@ -356,7 +550,8 @@ void std_task(void)
   ---------------------------------------------------------------------------*/
 void ctrl_task(void)
 {
-    if (eeprom_read_config(EEADR_MENU_ITEM(CF))) // true = Fahrenheit
+    if (menu_is_idle) config_flush(); // write changed menu-items to EEPROM
+    if (cfg.CF) // true = Fahrenheit
          fahrenheit = true;
     else fahrenheit = false;
 
@@ -366,6 +561,7 @@ void ctrl_task(void)
    {
        sound_alarm = true;
        RELAYS_OFF; // disable the output relays
+       set_alarm_blink(false); // probe alarm is shown steady
        if (menu_is_idle)
        {  // Make it less anoying to nagivate menu during alarm
           led_10 = LED_A;
@@ -376,7 +572,7 @@ void ctrl_task(void)
    } 
    else 
    {
-       ts = eeprom_read_config(EEADR_MENU_ITEM(Ts)); // Read Ts [seconds]
+       ts = cfg.Ts; // Read Ts [seconds]
        pid_control(ovbsc_pid_on);  // Control PID controller
        if (ovbsc_pump_on) 
        {
@@ -388,20 +584,9 @@ void ctrl_task(void)
            PUMP_OFF;
            led_e &= ~LED_COOL; // Cooling LED off
        } // else
-       if (menu_is_idle)           // show counter/temperature if menu is idle
-       {
-           if (sound_alarm && show_sa_alarm)
-           {
-               led_10 = al_led_10;
-	       led_1  = al_led_1;
-	       led_01 = al_led_01;
-           } else {
-               if (ovbsc_run_prg && (prg_state == PRG_BOIL) || (prg_state == PRG_WAIT_STRIKE))
-                    value_to_led(countdown,LEDS_INT);
-               else value_to_led(temp_ntc1,LEDS_TEMP);
-           } // else
-           show_sa_alarm = !show_sa_alarm;
-       } // if
+       set_alarm_blink(sound_alarm); // alarm text blinks in alarm_blink()
+       if (menu_is_idle && !show_sa_alarm) // show counter/temperature if menu is idle
+           show_temperature();
    } // else
 } // ctrl_task()
 #else
@@ -415,20 +600,26 @@ void ctrl_task(void)
 {
    int16_t sa, diff;
    
-    if (eeprom_read_config(EEADR_MENU_ITEM(CF))) // true = Fahrenheit
+    if (menu_is_idle) config_flush(); // write changed menu-items to EEPROM
+    if (cfg.CF) // true = Fahrenheit
          fahrenheit = true;
     else fahrenheit = false;
-    if (eeprom_read_config(EEADR_MENU_ITEM(HrS))) // true = hours
-         minutes = false; // control-timing is in hours 
-    else minutes = true;  // control-timing is in minutes
+    if (minutes == (cfg.HrS != 0)) // true = hours
+    {   // control-timing has changed: restart prfl_task() with the new period
+        minutes = !minutes;
+        if (minutes)
+             set_task_time_period(60000, TASK_PRF);   // every minute
+        else set_task_time_period(3600000, TASK_PRF); // every hour
+    } // if
 
    // Start with updating the alarm
    // cache whether the 2nd probe is enabled or not.
-   probe2 = (uint8_t)eeprom_read_config(EEADR_MENU_ITEM(Pb2)); 
+   probe2 = (uint8_t)cfg.Pb2; 
    if (ad_err1 || (ad_err2 && probe2))
    {
        sound_alarm = true;
        RELAYS_OFF; // disable the output relays
+       set_alarm_blink(false); // probe alarm is shown steady
        if (menu_is_idle)
        {  // Make it less anoying to nagivate menu during alarm
           led_10 = LED_A;
@@ -437,20 +628,20 @@ void ctrl_task(void)
           else         led_01 = LED_2;
 	  led_e = LED_OFF;
        } // if
-       cooling_delay = heating_delay = 60;
+       restart_delay_timers(); // 60 sec. delay after the alarm
    } else {
        sound_alarm = false; // reset the piezo buzzer
-       if(((uint8_t)eeprom_read_config(EEADR_MENU_ITEM(rn))) < THERMOSTAT_MODE)
+       if(((uint8_t)cfg.rn) < THERMOSTAT_MODE)
             led_e |=  LED_SET; // Indicate profile mode
        else led_e &= ~LED_SET;
  
-       ts = eeprom_read_config(EEADR_MENU_ITEM(Ts)); // Read Ts [seconds]
-       sa = eeprom_read_config(EEADR_MENU_ITEM(SA)); // Show Alarm parameter
+       ts = cfg.Ts; // Read Ts [seconds]
+       sa = cfg.SA; // Show Alarm parameter
        if (sa)
        {
            if (minutes) // is timing-control in minutes?
                 diff = temp_ntc1 - setpoint;
-	   else diff = temp_ntc1 - eeprom_read_config(EEADR_MENU_ITEM(SP));
+	   else diff = temp_ntc1 - cfg.SP;
 
 	   if (diff < 0) diff = -diff;
 	   if (sa < 0)
@@ -461,7 +652,7 @@ void ctrl_task(void)
               sound_alarm = (diff >= sa); // enable buzzer if diff is large
 	   } // if
        } // if
-       if (!minutes) setpoint = eeprom_read_config(EEADR_MENU_ITEM(SP));
+       if (!minutes) setpoint = cfg.SP;
        if (ts == 0)                // PID Ts parameter is 0?
        {
            temperature_control();  // Run thermostat
@@ -471,53 +662,24 @@ void ctrl_task(void)
        {
            pid_control(true);      // Run PID controller
            RELAYS_OFF;             // Disable relays
+           reset_temperature_control(); // Stop thermostat and its delay timers
        } // else
-       if (menu_is_idle)           // show temperature if menu is idle
-       {
-           if (sound_alarm && show_sa_alarm)
-           {
-               led_10 = LED_A;
-	       led_1  = LED_L;
-	       led_01 = LED_d;
-           } else {
-               led_e &= ~LED_POINT; // LED in middle, does not seem to work
-               switch (sensor2_selected)
-               {
-                   case 0: value_to_led(temp_ntc1,LEDS_TEMP); 
-                           break;
-                   case 1: value_to_led(temp_ntc2,LEDS_TEMP); 
-                           led_e |= LED_POINT;
-                           break;
-                   case 2: value_to_led(pid_out  ,LEDS_PERC) ; 
-                           break;
-               } // switch
-           } // else
-           show_sa_alarm = !show_sa_alarm;
-       } // if
+       set_alarm_blink(sound_alarm); // alarm text blinks in alarm_blink()
+       if (menu_is_idle && !show_sa_alarm) // show temperature if menu is idle
+           show_temperature();
    } // else
 } // ctrl_task()
 
 /*-----------------------------------------------------------------------------
   Purpose  : This task is called every minute or every hour and updates the
-             current running temperature profile.
-  Variables: minutes: timing control: false = hours, true = minutes
+             current running temperature profile. The period is set by
+             ctrl_task(), depending on the HrS menu item.
+  Variables: -
   Returns  : -
   ---------------------------------------------------------------------------*/
 void prfl_task(void)
 {
-    static uint8_t min = 0;
-    
-    if (minutes)
-    {   // call every minute
-        update_profile();
-        min = 0;
-    } else {
-        if (++min >= 60)
-        {   // call every hour
-            min = 0;
-            update_profile(); 
-        } // if
-    } // else
+    update_profile();
 } // prfl_task();
 #endif
 
@@ -537,21 +699,36 @@ int main(void)
     initialise_system_clock(); // Set system-clock to 16 MHz
     setup_output_ports();      // Init. needed output-ports for LED and keys
     setup_timer2();            // Set Timer 2 to 1 kHz
+#if defined(SCHED_ACTIVE_HALT)
+    CLK.ICKR.reg.LSIEN = 1;   // Enable the LSI, needed for the AWU
+    while (CLK.ICKR.reg.LSIRDY == 0); // Wait for the LSI to be ready for use.
+#endif
+#if defined(SCHED_STATS)
+    setup_timer1();            // Free-running 1 MHz counter for task timing
+#endif
+    config_load();             // RAM copy of all menu-items in EEPROM
 #if !(defined(OVBSC))
     pwr_on = eeprom_read_config(EEADR_POWER_ON); // check pwr_on flag
 #endif    
-    // Initialise all tasks for the scheduler
-    add_task(adc_task ,"ADC",  0,  500); // every 500 msec.
-    add_task(std_task ,"STD", 50,  100); // every 100 msec.
-    add_task(ctrl_task,"CTL",200, 1000); // every second
-#if !(defined(OVBSC))
-    add_task(prfl_task,"PRF",300,60000); // every minute / hour
-#endif    
+    init_tasks();              // Initialise all tasks of TASK_DATA for the scheduler
     ENABLE_INTERRUPTS;
 
     while (1)
     {   // background-processes
         dispatch_tasks();       // Run task-scheduler()
-        //__wait_for_interrupt(); // do nothing
+        eeprom_poll();          // Program queued EEPROM writes in the background
+        DISABLE_INTERRUPTS;
+        if (!sched_pending && (evt_head == evt_tail))
+        {   // Nothing to do until the next interrupt
+#if defined(SCHED_ACTIVE_HALT)
+            // Halt only if no task is released during the AWU period: an active-halt
+            // pays off after 0.2 msec. already, see the power model in tools/host/sched_rta
+            if (!pwr_on && (adc_state == ADC_IDLE) && (eep_q_cnt == 0) && (eep_jstate == EEP_J_IDLE) && (sched_next_release() > AWU_MSEC * TICKS_PER_SEC / 1000 + 1))
+                 active_halt();
+            else 
+#endif
+            WAIT_FOR_INTERRUPT; // Sleep, this also enables interrupts
+        } // if
+        ENABLE_INTERRUPTS;
     } // while
 } // main()
@@ -62,12 +62,13 @@
 #include <stm8as.h>
 #include "stm8_interrupt_vector.h"  // ISR routines. For SDCC: must be included in source containing main()
 #include <stdint.h>
+#include <stdbool.h>
 
 
 /* Define STC-1000+ version number (XYY, X=major, YY=minor) */
 /* Also, keep track of last version that has changes in EEPROM layout */
 #define STC1000P_VERSION	(210)
-#define STC1000P_EEPROM_VERSION	 (20)
+#define STC1000P_EEPROM_VERSION	 (23)
 
 // Common-Cathode bits on PB5, PB4, PD5 and PD4
 #define CC_10      (0x20)
@@ -144,6 +145,9 @@
 #define LED_u	(0xC1)
 #define LED_y	(0xB3)
 
+// Time in active-halt mode, see active_halt()
+#define AWU_MSEC    (64)
+
 #define LED_HEAT    (0x01)
 #define LED_SET     (0x02)
 #define LED_COOL    (0x04)
@@ -154,16 +158,75 @@
 #define LED_NEG     (0x80)
 
 // Function prototypes
-void save_display_state(void);
-void restore_display_state(void);
 void multiplexer(void);
 void initialise_system_clock(void);
 void initialise_timer2(void);
 void setup_timer2(void);
+void setup_timer1(void);
 void setup_output_ports(void);
+void active_halt(void);
 void adc_task(void);
 void std_task(void);
 void ctrl_task(void);
 void prfl_task(void);
+void show_temperature(void);
+void disp_test_done(uint8_t data);
+void adc_done(uint8_t data);
+void cool_dly_done(void);
+void heat_dly_done(void);
+void alarm_blink(void);
+void set_alarm_blink(bool blink);
+
+// Task table for the scheduler: ID, function, initial delay (msec.), period (msec.)
+// and worst-case execution time (usec.). Every task gets an ID TASK_<name>, 
+// see scheduler.h. The WCET values are checked at compile-time in scheduler.c 
+// and by tools/host/sched_rta, they can be measured with SCHED_STATS (HI value
+// on the task statistics page).
+// Tasks never wait for the EEPROM, it is programmed by eeprom_poll() in the
+// main-loop (MAIN_LOOP_WCET), see tools/host/eep_test.
+// The initial delays are the phases chosen by tools/host/sched_phase, which
+// fails when they have to be chosen again, e.g. after a WCET was changed.
+#if defined(OVBSC)
+#define TASK_DATA(_) \
+    _(ADC, adc_task ,   0,   500,  1500) /* every 500 msec. */ \
+    _(STD, std_task ,  50,   100,  1000) /* every 100 msec. */ \
+    _(CTL, ctrl_task, 100,  1000,  3000) /* every second    */
+#else
+#define TASK_DATA(_) \
+    _(ADC, adc_task ,   0,   500,  1500) /* every 500 msec. */ \
+    _(STD, std_task ,  50,   100,  1000) /* every 100 msec. */ \
+    _(CTL, ctrl_task, 100,  1000,  3000) /* every second    */ \
+    _(PRF, prfl_task, 200, 60000, 14000) /* every minute, every hour with HrS */
+#endif
+
+// Timer table for the scheduler: ID, callback function and worst-case execution
+// time (usec.). Timers are started with start_timer() and every timer gets an 
+// ID TMR_<name>, see scheduler.h
+#if defined(OVBSC)
+#define TIMER_DATA(_) \
+    _(ALM_BLINK, alarm_blink  , 300) /* alarm text on the display  */
+#else
+#define TIMER_DATA(_) \
+    _(COOL_DLY , cool_dly_done,  50) /* cooling delay of thermostat */ \
+    _(HEAT_DLY , heat_dly_done,  50) /* heating delay of thermostat */ \
+    _(ALM_BLINK, alarm_blink  , 300) /* alarm text on the display  */
+#endif
+
+// Worst-case execution time (usec.) of the Timer 2 interrupt (scheduler_isr()
+// and multiplexer() or adc_start()), which runs every msec.
+#define TIM2_ISR_WCET (40)
+
+// Worst-case execution time (usec.) of the rest of the main-loop between two
+// dispatch_tasks() passes: eeprom_poll() and disp_test_done(). The run-time
+// of adc_done() is part of the WCET of the ADC task. eeprom_poll() computes
+// the CRC-16 of the configuration area for a profile edit, as config_flush()
+// in the CTL task does: 3000 usec. of it.
+#define MAIN_LOOP_WCET (3200)
+
+// Event table for the scheduler: ID, handler. Events are posted by interrupt
+// routines with post_event() and every event gets an ID EVT_<name>.
+#define EVENT_DATA(_) \
+    _(DISP_TEST, disp_test_done) /* 7-segment display test has finished */ \
+    _(ADC_DONE , adc_done)       /* ADC conversions of the NTC probes done */
 
 #endif // __STC1000P_H__
@@ -68,13 +68,11 @@ const uint8_t led_lookup[] = {LED_0,LED_1,LED_2,LED_3,LED_4,LED_5,LED_6,LED_7,LE
 uint8_t led_e = {0x00};         // value of extra LEDs
 uint8_t led_10, led_1, led_01;  // values of 10s, 1s and 0.1s
 
-uint16_t cooling_delay = 60;    // Initial cooling delay
-uint16_t heating_delay = 60;    // Initial heating delay
 uint8_t  menustate     = MENU_IDLE; // Current STD state number for menu_fsm()
 bool     menu_is_idle  = true;  // No menu active within STD
 bool     pwr_on        = true;  // True = power ON, False = power OFF
 bool     fahrenheit    = false; // false = Celsius, true = Fahrenheit
-bool     minutes       = false; // timing control: false = hours, true = minutes
+bool     minutes       = true;  // timing control: false = hours, true = minutes (TASK_PRF period)
 uint8_t  menu_item     = 0;     // Current menu-item: [0..NO_OF_PROFILES]
 uint8_t  config_item   = 0;     // Current index within profile or parameter menu
 uint8_t  m_countdown   = 0;     // Timer used within menu_fsm()
@@ -87,11 +85,25 @@ uint16_t curr_dur = 0;          // local counter for temperature duration
 int16_t  pid_out  = 0;          // Output from PID controller in E-1 %
 int16_t  hysteresis;            // th-mode: hysteresis for temp probe ; pid-mode: lower hyst. limit in E-1 %
 int16_t  hysteresis2;           // th-mode: hysteresis for 2nd temp probe ; pid-mode: upper hyst. limit in E-1 %
+#if !(defined(OVBSC))
+uint8_t  std_x = STD_OFF;       // STD state number for temperature_control()
+#endif
+#if defined(SCHED_STATS)
+uint8_t  stats_task  = 0;       // Task shown on hidden task statistics page
+uint8_t  stats_field = 0;       // Value shown: last, min, max, latency, overruns
+bool     stats_show_value = false; // false = show name of value, true = show value
+
+// Names of the task statistics values: LA(st), Lo(w), HI(gh), dL(atency), Or(overruns)
+const uint8_t stats_led[] = {LED_L,LED_A, LED_L,LED_o, LED_H,LED_I, LED_d,LED_L, LED_O,LED_r};
+#endif
 
 // External variables, defined in other files
 extern bool     sound_alarm; // true = sound alarm
+extern volatile uint8_t keys;     // buttons read by multiplexer()
+extern volatile bool    keys_req; // true = multiplexer() reads the buttons
 extern uint8_t  probe2;    // cached flag indicating whether 2nd probe is active
 extern int16_t  temp_ntc1; // The temperature in E-1 C from NTC probe 1
+extern int16_t  temp_ntc1_e2; // The temperature in E-2 C from NTC probe 1
 extern int16_t  temp_ntc2; // The temperature in E-1 C from NTC probe 2
 extern int16_t  kc;        // Parameter value for Kc value in %/C
 extern uint16_t ti;        // Parameter value for I action in seconds
@@ -201,6 +213,50 @@ void prx_to_led(uint8_t run_mode, uint8_t is_menu)
 } // prx_to_led()
 #endif
 
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine converts a temperature in E-1 C into the display 
+             unit. Temperatures are kept in C everywhere (ADC, control, 
+             EEPROM), only the display and the menu use F.
+             0.1 C is 0.18 F, so the display shows every E-1 C value, 
+             but not every E-1 F value is a whole number of E-1 C: 
+             68.0 F is 20.0 C, 68.1 F is 20.06 C and 68.2 F is 20.1 C.
+             step_config_value() skips such a value in the menu.
+  Variables: value: temperature in E-1 C
+             kind : TEMP_ABS : absolute temperature
+                    TEMP_DIFF: temperature difference, no offset of 32 F
+                    TEMP_NONE: not a temperature, value is returned as is
+  Returns  : value in E-1 F if fahrenheit is set, value otherwise
+  ---------------------------------------------------------------------------*/
+int16_t temp_to_disp(int16_t value, uint8_t kind)
+{
+    if (fahrenheit && (kind != TEMP_NONE))
+    {   // 9/5 with rounding
+        value = (value * 9 + ((value < 0) ? -2 : 2)) / 5;
+        if (kind == TEMP_ABS) value += 320;
+    } // if
+    return value;
+} // temp_to_disp()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine converts a temperature in display units back into 
+             E-1 C. It is the inverse of temp_to_disp(), a value converted
+             by temp_to_disp() is returned unchanged by this routine. A F
+             value that temp_to_disp() does not return is rounded to the 
+             nearest E-1 C, e.g. 68.1 F gives 20.1 C (68.2 F).
+  Variables: value: temperature in E-1 F or E-1 C
+             kind : TEMP_ABS, TEMP_DIFF or TEMP_NONE, see temp_to_disp()
+  Returns  : value in E-1 C
+  ---------------------------------------------------------------------------*/
+int16_t disp_to_temp(int16_t value, uint8_t kind)
+{
+    if (fahrenheit && (kind != TEMP_NONE))
+    {   // 5/9 with rounding
+        if (kind == TEMP_ABS) value -= 320;
+        value = (value * 5 + ((value < 0) ? -4 : 4)) / 9;
+    } // if
+    return value;
+} // disp_to_temp()
+
 /*-----------------------------------------------------------------------------
   Purpose  : This routine is called by menu_fsm() to show the value of a
              temperature or a non-temperature value.
@@ -208,8 +264,9 @@ void prx_to_led(uint8_t run_mode, uint8_t is_menu)
              In case of a non-temperature value, only the value itself is shown.
   Variables: value: the value to display
              mode : LEDS_INT : display as integer
-                    LEDS_TEMP: display temperature as xx.1
+                    LEDS_TEMP: display temperature in E-1 C as xx.1 C or F
                     LEDS_PERC: display percentage as xx.1
+                    LEDS_DISP: display temperature in display units as xx.1
   Returns  : -
   ---------------------------------------------------------------------------*/
 void value_to_led(int value, uint8_t mode) 
@@ -218,14 +275,19 @@ void value_to_led(int value, uint8_t mode)
         uint8_t decimal = 0;
 
 	led_e &= ~(LED_NEG | LED_DEGR | LED_CELS); // clear negative,  and Celsius symbols
+        if (mode == LEDS_TEMP)
+        {  // convert E-1 C into display units
+           value = temp_to_disp(value, TEMP_ABS);
+           mode  = LEDS_DISP;
+        } // if
         if (value < 0) 
         {  // Handle negative values
            led_e |= LED_NEG;
 	   value  = -value;
 	} // if
 
-        if (mode == LEDS_TEMP)
-        {  // this is a temperature in E-1 C
+        if (mode == LEDS_DISP)
+        {  // this is a temperature in E-1 C or E-1 F
 	   led_e |= LED_DEGR;
            if (!fahrenheit) led_e |= LED_CELS; // Celsius symbol
            decimal = 1;
@@ -282,7 +344,7 @@ void value_to_led(int value, uint8_t mode)
   ---------------------------------------------------------------------------*/
 void update_profile(void)
 {
-  uint8_t  profile_no = eeprom_read_config(EEADR_MENU_ITEM(rn));
+  uint8_t  profile_no = cfg.rn;
   uint8_t  curr_step;            // Current step number within a profile
   uint8_t  profile_step_eeaddr;  // Address index in eeprom for step nr in profile
   uint16_t profile_step_dur;     // Duration of current step
@@ -295,10 +357,10 @@ void update_profile(void)
   // Running profile?
   if (profile_no < THERMOSTAT_MODE) 
   {
-      curr_step = eeprom_read_config(EEADR_MENU_ITEM(St));
+      curr_step = cfg.St;
       if (minutes) // is timing-control in minutes?
            curr_dur++;
-      else curr_dur = eeprom_read_config(EEADR_MENU_ITEM(dh)) + 1;
+      else curr_dur = cfg.dh + 1;
 
       // Sanity check
       if(curr_step > NO_OF_TT_PAIRS-1) curr_step = NO_OF_TT_PAIRS - 1;
@@ -322,7 +384,7 @@ void update_profile(void)
 	  curr_step++;  // Update step
 	  eeprom_write_config(EEADR_MENU_ITEM(St), curr_step);
       } // if
-      else if (eeprom_read_config(EEADR_MENU_ITEM(rP))) 
+      else if (cfg.rP) 
       {  // Is ramping enabled?
          profile_step_sp = eeprom_read_config(profile_step_eeaddr);
 	 t  = curr_dur << 6;
@@ -456,33 +518,72 @@ int16_t check_config_value(int16_t config_value, uint8_t eeadr)
     return range(config_value, t_min, t_max);
 } // check_config_value()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine is called by menu_fsm() to change a parameter value
+             with the UP or DOWN button. In F, a temperature that is not a
+             whole number of E-1 C (see temp_to_disp()) is skipped, so that
+             the value shown is exactly the value stored. Between two values
+             that can be stored there is at most one that can not.
+  Variables: config_value: the value in display units
+             step        : the change, +1 or -1 (+10 or -10 when accelerated)
+             eeadr       : the number of a 16-bit variable within the EEPROM.
+  Returns  : the new value, constrained by check_config_value()
+  ---------------------------------------------------------------------------*/
+int16_t step_config_value(int16_t config_value, int8_t step, uint8_t eeadr)
+{
+    uint8_t kind = config_temp_type(eeadr);
+
+    config_value += step;
+    if (temp_to_disp(disp_to_temp(config_value, kind), kind) != config_value)
+    {   // not stored exactly, take the next value in the same direction
+        config_value += (step < 0) ? -1 : 1;
+    } // if
+    return check_config_value(config_value, eeadr);
+} // step_config_value()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine returns what kind of temperature a parameter is, 
+             so that menu_fsm() can convert it with temp_to_disp() and 
+             disp_to_temp().
+  Variables: eeadr : the number of a 16-bit variable within the EEPROM.         
+  Returns  : TEMP_ABS, TEMP_DIFF or TEMP_NONE
+  ---------------------------------------------------------------------------*/
+uint8_t config_temp_type(uint8_t eeadr)
+{
+    uint8_t type;
+    
+#if defined(OVBSC)
+    if (eeadr == MENU_SIZE) return TEMP_NONE; // rUn
+#else
+    if (eeadr < EEADR_MENU)
+    {   // One of the Profiles: setpoints are at even addresses
+	while (eeadr >= PROFILE_SIZE)
+        {   // Find the eeprom address within a profile
+            eeadr -= PROFILE_SIZE;
+	} // while
+        return (eeadr & 0x1) ? TEMP_NONE : TEMP_ABS;
+    } // if
+#endif
+    type = menu[eeadr - EEADR_MENU].type;
+    if (type == t_temperature)            return TEMP_ABS;
+    if (MENU_TYPE_IS_TEMPERATURE(type))   return TEMP_DIFF;
+    return TEMP_NONE;
+} // config_temp_type()
+
 /*-----------------------------------------------------------------------------
   Purpose  : This routine reads the values of the buttons and returns the
              result. Routine should be called every 100 msec.
+             The buttons are read by multiplexer() in its blank slot, this
+             routine takes the last value and requests the next one.
              The result is returned in the global variable _buttons. 
   Variables: -
   Returns  : -
   ---------------------------------------------------------------------------*/
 void read_buttons(void)
 {
-    uint8_t b;
-    
-    // Save registers that interferes with LED's and disable common-cathodes
-    DISABLE_INTERRUPTS;     // Disable interrups while reading buttons
-    save_display_state();      // Save current state of 7-segment displays 
-
-    PORT_C.DDR.byte &= ~BUTTONS;        // Set PORT_C6..PORT_C3 as inputs
-    PORT_C.CR1.byte |=  BUTTONS;        // Enable pull-ups for PORT_C6..PORT_C3 (Rpu is approx 45k)
-    for (b = 0; b < 10; b++) ; // give port a bit of time
-    _buttons <<= 4;            // make room for new values of buttons
-    b          = ((PORT_C.IDR.byte & BUTTONS) >> 3); // 3..0: UP, DOWN, PWR, S
-    b          = (b ^ 0x0F) & 0x0F;         // Invert buttons (0 = pressed)
-    _buttons  |= b;            // add buttons
-    PORT_C.DDR.byte    |= BUTTONS;      // Set PORT_C6..PORT_C3 to outputs again
-    PORT_C.CR1.byte    |= BUTTONS;      // Set PORT_C6..PORT_C3 to Push-Pull again
-        
-    restore_display_state();   // Restore state of 7-segment displays
-    ENABLE_INTERRUPTS;      // Re-enable Interrupts
+    _buttons <<= 4;    // make room for new values of buttons
+    _buttons  |= keys; // add buttons, 3..0: UP, DOWN, PWR, S
+    keys_req   = true; // read them again for the next call
 } // read_buttons()
 
 /*-----------------------------------------------------------------------------
@@ -494,6 +595,7 @@ void read_buttons(void)
   ---------------------------------------------------------------------------*/
 void menu_fsm(void)
 {
+    int8_t step; // change of config_value by the UP and DOWN buttons
 #if !(defined(OVBSC))
     uint8_t run_mode, eeadr_sp;
 #else
@@ -514,6 +616,10 @@ void menu_fsm(void)
     else led_e |=  LED_SET;
 #endif
     uint8_t adr, type;
+#if defined(SCHED_STATS)
+    task_stats stats;
+    uint16_t   x;
+#endif
    
    if (m_countdown) m_countdown--; // countdown counter
     
@@ -540,6 +646,13 @@ void menu_fsm(void)
             else if(_buttons && eeprom_read_config(EEADR_POWER_ON))
 #endif
             {
+#if defined(SCHED_STATS)
+                if (BTN_PRESSED(BTN_UP | BTN_S))
+                {   // UP and S button pressed: hidden task statistics page
+                    stats_show_value = false;
+                    menustate        = MENU_SHOW_TASK_STATS;
+                } else
+#endif
                 if (BTN_PRESSED(BTN_UP | BTN_DOWN)) 
                 {   // UP and DOWN button pressed
                     menustate = MENU_SHOW_VERSION;
@@ -568,11 +681,7 @@ void menu_fsm(void)
                 pwr_on = eeprom_read_config(EEADR_POWER_ON);
                 pwr_on = !pwr_on;
                 eeprom_write_config(EEADR_POWER_ON, pwr_on);
-                if (pwr_on)
-                {
-                    heating_delay = 60; // 60 sec.
-                    cooling_delay = 60; // 60 sec.
-                } // else
+                if (pwr_on) restart_delay_timers(); // 60 sec.
                 menustate = MENU_IDLE;
             } else if(!BTN_HELD(BTN_PWR))
             {   // 0 = temp_ntc1, 1 = temp_ntc2, 2 = pid-output
@@ -624,7 +733,7 @@ void menu_fsm(void)
 #else           
            if (minutes) // is timing-control in minutes?
                  value_to_led(setpoint,LEDS_TEMP);
-	    else value_to_led(eeprom_read_config(EEADR_MENU_ITEM(SP)),LEDS_TEMP);
+	    else value_to_led(cfg.SP,LEDS_TEMP);
 #endif
 	    if(!BTN_HELD(BTN_UP)) menustate = MENU_IDLE;
 	    break;
@@ -704,7 +813,7 @@ void menu_fsm(void)
 		} // if
 	   } // if 
 #else
-           run_mode = eeprom_read_config(EEADR_MENU_ITEM(rn));
+           run_mode = cfg.rn;
             prx_to_led(run_mode,LEDS_RUN_MODE);
             if ((run_mode < THERMOSTAT_MODE) && (m_countdown == 0))
             {
@@ -723,7 +832,7 @@ void menu_fsm(void)
                m_countdown = 20;
                menustate = MENU_SHOW_STATE_DOWN;
 #else
-	    value_to_led(eeprom_read_config(EEADR_MENU_ITEM(St)),LEDS_INT);
+	    value_to_led(cfg.St,LEDS_INT);
 	    if (m_countdown == 0)
             {
                 m_countdown = TMR_SHOW_PROFILE_ITEM;
@@ -737,7 +846,7 @@ void menu_fsm(void)
        case MENU_SHOW_STATE_DOWN_3: // Show current duration of running profile
            if (minutes) // is timing-control in minutes?
                  value_to_led(curr_dur,LEDS_INT);
-            else value_to_led(eeprom_read_config(EEADR_MENU_ITEM(dh)),LEDS_INT);
+            else value_to_led(cfg.dh,LEDS_INT);
             if(m_countdown == 0)
             {   // Time-Out
                 m_countdown = TMR_SHOW_PROFILE_ITEM;
@@ -832,8 +941,8 @@ void menu_fsm(void)
             else if (BTN_RELEASED(BTN_S))
             {
                 if (config_item < MENU_SIZE)
-                {
-                    config_value = eeprom_read_config(config_item);
+                {   // edit temperatures in display units
+                    config_value = temp_to_disp(eeprom_read_config(config_item), config_temp_type(config_item));
                 } 
                 else 
                 {
@@ -892,7 +1001,7 @@ void menu_fsm(void)
                         config_item = MENU_SIZE-1;
                     } // if
             chk_skip_menu_item: // label for goto
-                    if (!minutes && ((uint8_t)eeprom_read_config(EEADR_MENU_ITEM(rn)) >= THERMOSTAT_MODE))
+                    if (!minutes && ((uint8_t)cfg.rn >= THERMOSTAT_MODE))
                     {
                         if (config_item == St)
                         {   // Skip current profile-step and duration
@@ -907,7 +1016,7 @@ void menu_fsm(void)
             } else if(BTN_RELEASED(BTN_S))
             {   // S-button is released again
                 adr          = MI_CI_TO_EEADR(menu_item, config_item);
-                config_value = eeprom_read_config(adr);
+                config_value = temp_to_disp(eeprom_read_config(adr), config_temp_type(adr)); // edit in display units
                 config_value = check_config_value(config_value, adr);
                 m_countdown  = TMR_NO_KEY_TIMEOUT;
                 menustate    = MENU_SHOW_CONFIG_VALUE;
@@ -922,7 +1031,7 @@ void menu_fsm(void)
                 type = menu[config_item].type;
                 if (MENU_TYPE_IS_TEMPERATURE(type))
                 {   // temperature, display in 0.1
-                    value_to_led(config_value,LEDS_TEMP);
+                    value_to_led(config_value,LEDS_DISP);
                 } 
                 else if (type == t_bool_cf)
                 {   // Celsius or Fahrenheit
@@ -964,13 +1073,13 @@ void menu_fsm(void)
 #else
            if (menu_item < MENU_ITEM_NO)
             {   // Display duration as integer, temperature in 0.1
-                value_to_led(config_value, (config_item & 0x1) ? LEDS_INT : LEDS_TEMP);
+                value_to_led(config_value, (config_item & 0x1) ? LEDS_INT : LEDS_DISP);
             } else 
             {   // menu_item == MENU_ITEM_NO
                 type = menu[config_item].type;
                 if(MENU_TYPE_IS_TEMPERATURE(type))
                 {   // temperature, display in 0.1
-                    value_to_led(config_value,LEDS_TEMP);
+                    value_to_led(config_value,LEDS_DISP);
                 } else if (type == t_runmode)
                 {
                     prx_to_led(config_value,LEDS_RUN_MODE);
@@ -999,23 +1108,19 @@ void menu_fsm(void)
             } 
             else if(BTN_HELD_OR_RELEASED(BTN_UP)) 
             {
-                config_value++;
-                if ((config_value > 1000) || (--key_held_tmr < 0))
-                {
-                    config_value += 9;
-                } // if
+                step = 1;
                 /* Jump to exit code shared with BTN_DOWN case */
                 goto chk_cfg_acc_label;
             } 
             else if(BTN_HELD_OR_RELEASED(BTN_DOWN)) 
             {
-                config_value--;
+                step = -1;
+            chk_cfg_acc_label: // label for goto
                 if ((config_value > 1000) || (--key_held_tmr < 0))
                 {
-                    config_value -= 9;
+                    step *= 10;
                 } // if
-            chk_cfg_acc_label: // label for goto
-                config_value = check_config_value(config_value, adr);
+                config_value = step_config_value(config_value, step, adr);
                 menustate    = MENU_SHOW_CONFIG_VALUE;
             } 
             else if(BTN_RELEASED(BTN_S))
@@ -1023,7 +1128,7 @@ void menu_fsm(void)
 #if defined(OVBSC)
                 if (config_item < MENU_SIZE)
                 {
-                    eeprom_write_config(config_item, config_value);
+                    eeprom_write_config(config_item, disp_to_temp(config_value, config_temp_type(config_item)));
                 } // if
                 else 
                 {
@@ -1074,7 +1179,8 @@ void menu_fsm(void)
                         } // if
                     } // if
                 } // if
-                eeprom_write_config(adr, config_value);
+                if (!eeprom_write_config(adr, disp_to_temp(config_value, config_temp_type(adr))))
+                    break; // profile values still waiting for the EEPROM: S again
 #endif
                 menustate = MENU_SHOW_CONFIG_ITEM;
             } else 
@@ -1082,6 +1188,58 @@ void menu_fsm(void)
                 key_held_tmr = TMR_KEY_ACC; 
             } // else
             break; // MENU_SET_CONFIG_VALUE
+#if defined(SCHED_STATS)
+       //--------------------------------------------------------------------         
+       case MENU_SHOW_TASK_STATS: // Hidden page, alternates name and value
+            led_e &= ~(LED_NEG | LED_DEGR | LED_CELS | LED_POINT);
+            if (stats_show_value)
+            {
+                get_task_stats(stats_task, &stats);
+                switch (stats_field)
+                {   // in the order of stats_led[]
+                    case 0 : x = stats.Last;       break;
+                    case 1 : x = stats.Min;        break;
+                    case 2 : x = stats.Max;        break;
+                    case 3 : x = stats.LatencyMax; break;
+                    default: x = stats.Overruns;   break;
+                } // switch
+                if (stats_field < STATS_FIELDS - 1)
+                {   // time in usec., display in 0.1 msec.
+                    value_to_led(x / 100, LEDS_PERC);
+                } else 
+                {   // number of overruns
+                    value_to_led((x > 999) ? 999 : x, LEDS_INT);
+                } // else
+            } else
+            {   // task number and name of value
+                led_10 = led_lookup[stats_task];
+                led_1  = stats_led[stats_field << 1];
+                led_01 = stats_led[(stats_field << 1) + 1];
+            } // else
+            m_countdown = TMR_SHOW_PROFILE_ITEM;
+            menustate   = MENU_SET_TASK_STATS;
+            break; // MENU_SHOW_TASK_STATS
+       //--------------------------------------------------------------------         
+       case MENU_SET_TASK_STATS:
+            if (BTN_RELEASED(BTN_PWR))
+            {   // Go back
+                menustate = MENU_IDLE;
+            } else if (BTN_RELEASED(BTN_DOWN))
+            {   // next value, after the last value the next task
+                if (++stats_field >= STATS_FIELDS)
+                {
+                    stats_field = 0;
+                    if (++stats_task >= NO_OF_TASKS) stats_task = 0;
+                } // if
+                stats_show_value = false;
+                menustate        = MENU_SHOW_TASK_STATS;
+            } else if (m_countdown == 0)
+            {   // toggle between name and value
+                stats_show_value = !stats_show_value;
+                menustate        = MENU_SHOW_TASK_STATS;
+            } // else if
+            break; // MENU_SET_TASK_STATS
+#endif
        //--------------------------------------------------------------------         
        default:
             menustate = MENU_IDLE;
@@ -1099,7 +1257,7 @@ uint16_t min_to_sec(enum menu_enum x)
 {
     uint16_t retv;
    
-    retv = eeprom_read_config(EEADR_MENU_ITEM(x)) << 6; // * 64
+    retv = CFG_ITEM(x) << 6; // * 64
     retv = retv - (retv >> 4); // 64 - 4 = 60
     return retv;
 } // min_to_sec()
@@ -1128,31 +1286,96 @@ void fan_control(void)
         } // else
 } // fan_control()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : Callback of timer TMR_COOL_DLY: the cooling delay has passed.
+             The relay is switched on here, at the tick the delay ends, 
+             not in the next temperature_control() up to a second later.
+  Variables: std_x
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void cool_dly_done(void)
+{
+    if (std_x == STD_DLY_COOL)
+    {
+        std_x  = STD_COOLING; // COOLING
+        led_e |= LED_COOL;    // Cooling LED on
+        COOL_ON;              // Enable Cooling
+    } // if
+} // cool_dly_done()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Callback of timer TMR_HEAT_DLY: the heating delay has passed.
+             The relay is switched on here, see cool_dly_done().
+  Variables: std_x
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void heat_dly_done(void)
+{
+    if (std_x == STD_DLY_HEAT)
+    {
+        std_x  = STD_HEATING; // HEATING
+        led_e |= LED_HEAT;    // Heating LED on
+        HEAT_ON;              // Enable Heating
+    } // if
+} // heat_dly_done()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Restart a running cooling or heating delay with 60 seconds. 
+             Called after power-on and during an alarm.
+  Variables: std_x
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void restart_delay_timers(void)
+{
+    if      (std_x == STD_DLY_COOL) start_timer(TMR_COOL_DLY, 60000, 0); // 60 sec.
+    else if (std_x == STD_DLY_HEAT) start_timer(TMR_HEAT_DLY, 60000, 0); // 60 sec.
+} // restart_delay_timers()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Put the thermostat back in the OFF state and stop its delay
+             timers. Called when the PID controller is in control.
+  Variables: std_x
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void reset_temperature_control(void)
+{
+    if (std_x != STD_OFF)
+    {
+        cancel_timer(TMR_COOL_DLY);
+        cancel_timer(TMR_HEAT_DLY);
+        std_x = STD_OFF;
+    } // if
+} // reset_temperature_control()
+
 /*-----------------------------------------------------------------------------
   Purpose  : This routine controls the temperature setpoints. It should be 
-             called once every second by ctrl_task().
+             called once every second by ctrl_task(). The cooling and 
+             heating delays are one-shot timers, started when entering
+             the delay state and cancelled when leaving it early.
   Variables: -
   Returns  : -
   ---------------------------------------------------------------------------*/
 void temperature_control(void)
 {
-    static uint8_t std_x = 0;
-    
-    hysteresis  = eeprom_read_config(EEADR_MENU_ITEM(hy));
-    hysteresis2 = eeprom_read_config(EEADR_MENU_ITEM(hy2)) >> 1;
+    hysteresis  = cfg.hy;
+    hysteresis2 = cfg.hy2 >> 1;
     switch (std_x)
     {
         case STD_OFF: // OFF
-            cooling_delay = min_to_sec(cd);
             if (probe2 < 2)
             {
-                heating_delay = min_to_sec(hd);
                 RELAYS_OFF; // Disable Cooling and Heating relays
                 led_e &= ~(LED_HEAT | LED_COOL); // disable both LEDs
                 if ((temp_ntc1 > setpoint + hysteresis) && (!probe2 || (temp_ntc2 >= setpoint - hysteresis2))) 
+                {
+                    start_timer(TMR_COOL_DLY, min_to_sec(cd) * 1000L, 0);
                     std_x = STD_DLY_COOL; // COOLING DELAY
+                } // if
                 else if ((temp_ntc1 < setpoint - hysteresis) && (!probe2 || (temp_ntc2 <= setpoint + hysteresis2)))
+                {
+                    start_timer(TMR_HEAT_DLY, min_to_sec(hd) * 1000L, 0);
                     std_x = STD_DLY_HEAT; // HEATING_DELAY
+                } // else if
             } // if
             else
             {   // Probe2 >= 2, cooling with compressor fan control
@@ -1160,21 +1383,29 @@ void temperature_control(void)
                 led_e &= ~LED_COOL; // Cooling LED on
                 fan_control();      // controls fan of cooling compressor
                 if (temp_ntc1 > setpoint + hysteresis)
+                {
+                    start_timer(TMR_COOL_DLY, min_to_sec(cd) * 1000L, 0);
                     std_x = STD_DLY_COOL; // COOLING_DELAY
+                } // if
             } // else
             break;
-        case STD_DLY_HEAT: // HEATING DELAY
+        case STD_DLY_HEAT: // HEATING DELAY, ends in heat_dly_done()
             led_e ^= LED_HEAT; // Flash to indicate heating delay
             if ((temp_ntc1 > setpoint - hysteresis) ||
-                (probe2 && (temp_ntc2 > setpoint + hysteresis2))) std_x = STD_OFF;     // OFF
-            else if (--heating_delay == 0)                        std_x = STD_HEATING; // HEATING
+                (probe2 && (temp_ntc2 > setpoint + hysteresis2))) 
+            {
+                cancel_timer(TMR_HEAT_DLY);
+                std_x = STD_OFF; // OFF
+            } // if
             break;
-        case STD_DLY_COOL: // COOLING DELAY
+        case STD_DLY_COOL: // COOLING DELAY, ends in cool_dly_done()
             if (probe2 >= 2) fan_control(); // controls fan of cooling compressor
             if ((temp_ntc1 < setpoint + hysteresis) ||
                 ((probe2 == 1) && (temp_ntc2 < setpoint - hysteresis2))) 
-                                            std_x = STD_OFF;     // OFF
-            else if (--cooling_delay == 0)  std_x = STD_COOLING; // COOLING
+            {
+                cancel_timer(TMR_COOL_DLY);
+                std_x = STD_OFF; // OFF
+            } // if
             led_e ^= LED_COOL; // Flash to indicate cooling delay
             break;
         case STD_HEATING: // HEATING
@@ -1205,19 +1436,19 @@ void pid_control(bool pid_run)
 {
     static uint8_t pid_tmr = 0;
     
-    if (kc != eeprom_read_config(EEADR_MENU_ITEM(Hc)) ||
-        ti != eeprom_read_config(EEADR_MENU_ITEM(Ti)) ||
-        td != eeprom_read_config(EEADR_MENU_ITEM(Td)))
+    if (kc != cfg.Hc ||
+        ti != cfg.Ti ||
+        td != cfg.Td)
     {   // One or more PID parameters have changed
-       kc = eeprom_read_config(EEADR_MENU_ITEM(Hc));
-       ti = eeprom_read_config(EEADR_MENU_ITEM(Ti));
-       td = eeprom_read_config(EEADR_MENU_ITEM(Td));
-       init_pid(kc,ti,td,ts,temp_ntc1); // Init PID controller
+       kc = cfg.Hc;
+       ti = cfg.Ti;
+       td = cfg.Td;
+       init_pid(kc,ti,td,ts,temp_ntc1_e2); // Init PID controller
     } // if
     
     if (++pid_tmr >= ts) 
     {   // Call PID controller every TS seconds
-        pid_ctrl(temp_ntc1,&pid_out,setpoint,pid_run);
+        pid_ctrl(temp_ntc1_e2,&pid_out,setpoint,pid_run);
         pid_tmr = 0;
     } // if
 } // pid_control()
@@ -34,16 +34,19 @@
 #include "stc1000p.h"
 #include "eep.h"
 #include "pid.h"
+#include "scheduler.h"
 
-// Define limits for temperatures in Fahrenheit and Celsius
-#define TEMP_MAX_F	  (2500)
+// Define limits for temperatures in Fahrenheit and Celsius.
+// These are display units, all values in EEPROM are in E-1 C.
+// The F limits are the C limits converted, so both cover the same range.
+#define TEMP_MAX_F	  (2840)
 #define TEMP_MIN_F	  (-400)
-#define TEMP_CORR_MAX_F	  ( 100)
-#define TEMP_CORR_MIN_F	  (-100)
-#define TEMP_HYST_1_MAX_F ( 100)
-#define TEMP_HYST_2_MAX_F ( 500)
-#define SP_ALARM_MIN_F	  (-800)
-#define SP_ALARM_MAX_F	  ( 800)
+#define TEMP_CORR_MAX_F	  (  90)
+#define TEMP_CORR_MIN_F	  ( -90)
+#define TEMP_HYST_1_MAX_F (  90)
+#define TEMP_HYST_2_MAX_F ( 450)
+#define SP_ALARM_MIN_F	  (-720)
+#define SP_ALARM_MAX_F	  ( 720)
 
 #define TEMP_MAX_C	  (1400)
 #define TEMP_MIN_C	  (-400)
@@ -125,29 +128,32 @@ enum e_item_type
 // 	name, LED data 10, LED data 1, LED data 01, min value, max value, default value
 //
 // Sd	Strike delay	                                 0-999 minutes
-// St	Strike water setpoint                            -40.0 to +140 C or -40.0 to 250.0F
-// Pt1	Mash step 1 setpoint 	                         -40.0 to 140 C or -40.0 to 250.0 F
+// St	Strike water setpoint                            -40.0 to +140 C or -40.0 to 284.0F
+// Pt1	Mash step 1 setpoint 	                         -40.0 to 140 C or -40.0 to 284.0 F
 // Pd1	Mash step 1 duration                             0-999 minutes
-// Pt2	Mash step 2 setpoint 	                         -40.0 to 140 C or -40.0 to 250.0 F
+// Pt2	Mash step 2 setpoint 	                         -40.0 to 140 C or -40.0 to 284.0 F
 // Pd2	Mash step 2 duration                             0-999 minutes
-// Pt3	Mash step 3 setpoint 	                         -40.0 to 140 C or -40.0 to 250.0 F
+// Pt3	Mash step 3 setpoint 	                         -40.0 to 140 C or -40.0 to 284.0 F
 // Pd3	Mash step 3 duration                             0-999 minutes
-// Pt4	Mash step 4 setpoint 	                         -40.0 to 140 C or -40.0 to 250.0 F
+// Pt4	Mash step 4 setpoint 	                         -40.0 to 140 C or -40.0 to 284.0 F
 // Pd4	Mash step 4 duration                             0-999 minutes
-// Pt5	Mash step 5 setpoint 	                         -40.0 to 140 C or -40.0 to 250.0 F
+// Pt5	Mash step 5 setpoint 	                         -40.0 to 140 C or -40.0 to 284.0 F
 // Pd5	Mash step 5 duration                             0-999 minutes
-// Pt6	Mash step 6 setpoint 	                         -40.0 to 140 C or -40.0 to 250.0 F
+// Pt6	Mash step 6 setpoint 	                         -40.0 to 140 C or -40.0 to 284.0 F
 // Pd6	Mash step 6 duration                             0-999 minutes
-// Ht	Hot break temperature	                         -40.0 to 140 C or -40.0 to 250.0 F
+// Ht	Hot break temperature	                         -40.0 to 140 C or -40.0 to 284.0 F
 // Hd	Hot break duration	                         0-999 minutes
-// bt	Boil temperature	                         -40.0 to 140 C or -40.0 to 250.0 F
+// bt	Boil temperature	                         -40.0 to 140 C or -40.0 to 284.0 F
 // bd	Boil duration	                                 0-999 minutes
 // hd1	Hop alarm 1                                      0-999 minutes
 // hd2	Hop alarm 2                                      0-999 minutes
 // hd3	Hop alarm 3                                      0-999 minutes
 // hd4	Hop alarm 4                                      0-999 minutes
 // CF	Set Celsius of Fahrenheit temperature display    0 = Celsius, 1 = Fahrenheit
-// tc	Temperature correction	                         -5.0 to 5.0C or -10.0 to 10.0F
+// tc	Temperature correction	                         -5.0 to 5.0C or -9.0 to 9.0F
+// C0	Calibration: correction at 0 C                   -5.0 to 5.0C or -9.0 to 9.0F
+// C5	Calibration: correction at 50 C                  -5.0 to 5.0C or -9.0 to 9.0F
+// C1	Calibration: correction at 100 C                 -5.0 to 5.0C or -9.0 to 9.0F
 // Hc   Kc parameter for PID controller in %/C          -9999..9999, >0: heating loop, <0: cooling loop 
 // ti   Ti parameter for PID controller in seconds       0..9999 
 // td   Td parameter for PID controller in seconds       0..9999 
@@ -155,7 +161,7 @@ enum e_item_type
 // APF	Alarm/Pause control flags	                 0 to 511
 // PF	Pump control flags	                         0 to 31
 // cO   Manual mode output                               -200 to +200 % 
-// cSP  Manual mode Thermostat setpoint                  -40.0 to 140 C or -40.0 to 250.0 F
+// cSP  Manual mode Thermostat setpoint                  -40.0 to 140 C or -40.0 to 284.0 F
 // cP   Manual mode Pump                                 0 (off) or 1 (on) 
 // ASd  Safety shutdown timer                            0..999 minutes
 // rUn	Run mode	                                 OFF, Pr (run program), 
@@ -186,6 +192,9 @@ enum e_item_type
     _(hd4, 	LED_h, 	LED_d, 	LED_4,	   t_duration,		5)	\
     _(CF, 	LED_C, 	LED_F, 	LED_OFF,   t_bool_cf,	        0)	\
     _(tc, 	LED_t, 	LED_c, 	LED_OFF,   t_tempdiff,		0)	\
+    _(C0, 	LED_C, 	LED_0, 	LED_OFF,   t_tempdiff,		0)	\
+    _(C5, 	LED_C, 	LED_5, 	LED_OFF,   t_tempdiff,		0)	\
+    _(C1, 	LED_C, 	LED_1, 	LED_OFF,   t_tempdiff,		0)	\
     _(Hc, 	LED_H, 	LED_c, 	LED_OFF,   t_parameter,	        80)	\
     _(Ti, 	LED_t, 	LED_I, 	LED_OFF,   t_parameter,         280)	\
     _(Td, 	LED_t, 	LED_d, 	LED_OFF,   t_parameter,         20)	\
@@ -204,12 +213,18 @@ enum e_item_type
 // The values are:
 // 	name, LED data 10, LED data 1, LED data 01, min value, max value, default value
 //
-// SP	Set setpoint	                                 -40 to 140C or -40 to 250F
-// hy	Set hysteresis                                   0.0 to 5.0C or 0.0 to 10.0F
-// hy2	Set hysteresis for 2nd temp probe	         0.0 to 25.0C or 0.0 to 50.0F
-// tc	Set temperature correction	                 -5.0 to 5.0C or -10.0 to 10.0F
-// tc2	Set temperature correction for 2nd temp probe    -5.0 to 5.0C or -10.0 to 10.0F
-// SA	Setpoint alarm	                                 0 = off, -40 to 40C or -80 to 80F
+// SP	Set setpoint	                                 -40 to 140C or -40 to 284F
+// hy	Set hysteresis                                   0.0 to 5.0C or 0.0 to 9.0F
+// hy2	Set hysteresis for 2nd temp probe	         0.0 to 25.0C or 0.0 to 45.0F
+// tc	Set temperature correction	                 -5.0 to 5.0C or -9.0 to 9.0F
+// tc2	Set temperature correction for 2nd temp probe    -5.0 to 5.0C or -9.0 to 9.0F
+// C0	Calibration: correction at 0 C                   -5.0 to 5.0C or -9.0 to 9.0F
+// C5	Calibration: correction at 50 C                  -5.0 to 5.0C or -9.0 to 9.0F
+// C1	Calibration: correction at 100 C                 -5.0 to 5.0C or -9.0 to 9.0F
+// C02	Calibration 2nd temp probe: correction at 0 C    -5.0 to 5.0C or -9.0 to 9.0F
+// C52	Calibration 2nd temp probe: correction at 50 C   -5.0 to 5.0C or -9.0 to 9.0F
+// C12	Calibration 2nd temp probe: correction at 100 C  -5.0 to 5.0C or -9.0 to 9.0F
+// SA	Setpoint alarm	                                 0 = off, -40 to 40C or -72 to 72F
 // St	Set current profile step	                 0 to 8
 // dh	Set current profile duration	                 0 to 999 hours
 // cd	Set cooling delay	                         0 to 60 minutes
@@ -230,6 +245,12 @@ enum e_item_type
 	_(hy2, 	LED_h, 	LED_y, 	LED_2, 	 t_hyst_2, 	100)	        \
 	_(tc, 	LED_t, 	LED_c, 	LED_OFF, t_tempdiff,	0)		\
 	_(tc2, 	LED_t, 	LED_c, 	LED_2, 	 t_tempdiff,	0)		\
+	_(C0, 	LED_C, 	LED_0, 	LED_OFF, t_tempdiff,	0)		\
+	_(C5, 	LED_C, 	LED_5, 	LED_OFF, t_tempdiff,	0)		\
+	_(C1, 	LED_C, 	LED_1, 	LED_OFF, t_tempdiff,	0)		\
+	_(C02, 	LED_C, 	LED_0, 	LED_2, 	 t_tempdiff,	0)		\
+	_(C52, 	LED_C, 	LED_5, 	LED_2, 	 t_tempdiff,	0)		\
+	_(C12, 	LED_C, 	LED_1, 	LED_2, 	 t_tempdiff,	0)		\
 	_(SA, 	LED_S, 	LED_A, 	LED_OFF, t_sp_alarm,	0)		\
 	_(St, 	LED_S, 	LED_t, 	LED_OFF, t_step,	0)		\
 	_(dh, 	LED_d, 	LED_h, 	LED_OFF, t_duration,	0)		\
@@ -253,8 +274,26 @@ enum e_item_type
 enum menu_enum 
 {
     MENU_DATA(ENUM_VALUES)
+    NO_OF_MENU_ITEMS
 }; // menu_enum
 
+//---------------------------------------------------------------------------
+// RAM copy of all menu-items in EEPROM, loaded by config_load() at power-up.
+// Every menu-item is a field with the name of its enum value, e.g. cfg.SP,
+// in the same order as in EEPROM. Changes are written to the EEPROM by
+// config_flush(), see eep.c.
+//---------------------------------------------------------------------------
+#define CONFIG_FIELDS(name,led10ch,led1ch,led01ch,type,default_value) int16_t name;
+typedef struct _config_t
+{
+    MENU_DATA(CONFIG_FIELDS)
+} config_t;
+
+#define CFG_ITEM(x)      (((int16_t *)&cfg)[x]) // menu-item x of cfg, x = enum value
+#define CFG_DIRTY_BYTES  ((NO_OF_MENU_ITEMS + 7) >> 3)
+
+extern config_t cfg;
+
 //---------------------------------------------------------------------------
 // Macros for calculation of EEPROM addresses
 // One profile consists of several temp. time pairs and a final temperature
@@ -272,6 +311,53 @@ enum menu_enum
     #define EEADR_MENU				EEADR_PROFILE_SETPOINT(NO_OF_PROFILES, 0)
     // Set POWER_ON after LAST parameter (in this case rn)!
     #define EEADR_POWER_ON				(EEADR_MENU_ITEM(rn) + 1)
+
+    // Wear-levelled ring for the runtime state (SP, St, dh, rn and the
+    // power-on flag) in the unused upper half of the EEPROM, see eep.c.
+    // A record is 4 words: SP, dh, seq.nr|flags and a check-word.
+    #define EEADR_RING        (128)
+    #define RING_REC_SIZE     (4)
+    #define RING_SLOTS        (32)
+    #define RING_FLAG_PWR     (0x80) // power-on flag in the flags byte
+    // Last slot of the ring: keeps the newest record during a rewrite
+    #define EEADR_RING_KEEP   (EEADR_RING + (RING_SLOTS - 1) * RING_REC_SIZE)
+#endif
+
+// Header of the configuration area (profiles and menu-items), see config_load().
+// The header is 3 words: EEP_MAGIC, EEP_LAYOUT and the CRC-16 of the 
+// configuration area, words 0..EEADR_CFG_END-1.
+#define EEADR_HEADER      (120)
+#define EEADR_CFG_END     (EEADR_MENU + NO_OF_MENU_ITEMS)
+#define EEP_MAGIC         (0x5354) // "ST"
+
+// Journal for eeprom_begin()..eeprom_commit(), between the configuration area
+// and the header, words 72..119: the commit word (EEP_JMAGIC and the number 
+// of entries) at word 72, the check-word at word 73 and EEP_JOURNAL_SIZE 
+// entries of an address and a value at words 74..119.
+#define EEADR_JOURNAL     (72)
+#define EEP_JOURNAL_SIZE  (23)
+#define EEP_JMAGIC        (0xa5)
+
+// Rewrite of the configuration area (migration or default values) by
+// config_load(): the old configuration area is copied into the scratch area
+// and a marker (the old layout and a check-word) is written, before the 
+// configuration area is changed. The scratch area is the ring of the STC1000P, 
+// it is cleared after the rewrite, except for the last slot of the ring.
+#define EEADR_MARKER       (124)
+#define EEADR_SCRATCH      (128)
+#define EEP_SCRATCH_SIZE   (128)
+#if defined(OVBSC)
+    #define EEP_SCRATCH_CLEAR (EEP_SCRATCH_SIZE)
+#else
+    #define EEP_SCRATCH_CLEAR (EEADR_RING_KEEP - EEADR_SCRATCH)
+#endif
+#define EEP_DEFAULT_LAYOUT (0xffff) // marker: not migrated, set to default values
+#if defined(OVBSC)
+    #define EEP_LAYOUT        (STC1000P_EEPROM_VERSION << 8) // no profiles
+    #define EEP_LEGACY_LAYOUT (20 << 8)
+#else
+    #define EEP_LAYOUT        ((STC1000P_EEPROM_VERSION << 8) | (NO_OF_PROFILES << 4) | NO_OF_TT_PAIRS)
+    #define EEP_LEGACY_LAYOUT ((20 << 8) | (4 << 4) | 5) // EEPROM without header
 #endif
 
 // KEY_UP..KEY_S are the hardware bits on PORTC
@@ -300,8 +386,14 @@ enum menu_enum
 
 // Defines for value_to_led() function
 #define LEDS_INT      (0)
-#define LEDS_TEMP     (1)
+#define LEDS_TEMP     (1) // temperature in E-1 C, shown in C or F
 #define LEDS_PERC     (2)
+#define LEDS_DISP     (3) // temperature already in display units (menu)
+
+// Defines for temp_to_disp(), disp_to_temp() and config_temp_type()
+#define TEMP_NONE     (0) // not a temperature
+#define TEMP_ABS      (1) // absolute temperature: F = 1.8 * C + 32
+#define TEMP_DIFF     (2) // temperature difference: F = 1.8 * C
 
 // Timers for state transition diagram. One-tick = 100 msec.
 #define TMR_POWERDOWN          (30)
@@ -359,18 +451,31 @@ enum menu_states
     MENU_SET_CONFIG_ITEM,     // Change menu-item / profile-item
     MENU_SHOW_CONFIG_VALUE,   // Show value of menu-item / profile-item
     MENU_SET_CONFIG_VALUE,    // Change value of menu-item / profile-item
+#if defined(SCHED_STATS)
+    MENU_SHOW_TASK_STATS,     // Hidden page: show label or value of a task statistic
+    MENU_SET_TASK_STATS,      // Hidden page: select task statistic
+#endif
 }; // menu_states
 
+// Number of values per task shown on the hidden task statistics page
+#define STATS_FIELDS (5)
+
 // Function Prototypes
 uint16_t divu10(uint16_t n); 
 void     prx_to_led(uint8_t run_mode, uint8_t is_menu);
 void     value_to_led(int value, uint8_t mode); 
+int16_t  temp_to_disp(int16_t value, uint8_t kind);
+int16_t  disp_to_temp(int16_t value, uint8_t kind);
+uint8_t  config_temp_type(uint8_t eeadr);
 void     update_profile(void);
 int16_t  range(int16_t x, int16_t min, int16_t max);
 int16_t  check_config_value(int16_t config_value, uint8_t eeadr);
+int16_t  step_config_value(int16_t config_value, int8_t step, uint8_t eeadr);
 void     read_buttons(void);
 void     menu_fsm(void);
 void     temperature_control(void);
+void     restart_delay_timers(void);
+void     reset_temperature_control(void);
 void     pid_control(bool pid_run);
 void     ovbsc_fsm(void); // in ovbsc.c
 #endif
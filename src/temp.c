@@ -24,75 +24,228 @@
 */ 
 #include "temp.h"
 
-extern bool fahrenheit; // false = Celsius, true = Fahrenheit
+volatile uint8_t adc_state = ADC_IDLE; // ADC_IDLE..ADC_BUSY, display is off from ADC_SETTLE
+adc_sum_t     adc_sum[ADC_PROBES]; // sum of ADC_AVG conversion results per probe
+uint8_t       adc_cnt;          // number of conversions to go
+uint8_t       adc_probe;        // probe being converted: 0 = NTC1, 1 = NTC2
+#if defined(SCHED_STATS)
+uint16_t      adc_t0;           // TIM1 counter when adc_task() turned the display off
+uint16_t      adc_blank_us;     // display-off time of the last adc_task() in usec.
+uint16_t      adc_blank_max;    // longest display-off time in usec.
+#endif
+#if defined(ADC_MEDIAN)
+uint16_t      med_buf[2][3] = {{0x8000,0x8000,0x8000},{0x8000,0x8000,0x8000}}; // last 3 ADC-values per probe
+uint8_t       med_idx[2];       // next entry of med_buf[] to overwrite
+#endif
 
-/* Temperature lookup table  */
-const int ad_lookup_f[] = {0,-555,-319,-167,-49,48,134,211,282,348,412,474,534,593,652,711,770,831,893,957,1025,1096,1172,1253,1343,1444,1559,1694,1860,2078,2397,2987};
-const int ad_lookup_c[] = {0,-486,-355,-270,-205,-151,-104,-61,-21,16,51,85,119,152,184,217,250,284,318,354,391,431,473,519,569,624,688,763,856,977,1154,1482};
+/* Temperature lookup table ad_lookup_c[] in E-1 C, see tools/ntc_table.py */
+#include "ntc_table.h"
 
 /*-----------------------------------------------------------------------------
-  Purpose  : This routine reads a value from an ADC channel
- Variables : ch: channel number [AIN3,AIN4]
-  Returns  : the value read from the ADC
+  Purpose  : This routine starts ADC_CONV conversions in the background,
+             alternating between NTC probe 1 and 2, so that both probes get
+             ADC_AVG conversions from the same time-window. Every result is
+             added to adc_sum[] by adc_isr(), which posts EVT_ADC_DONE 
+             after the last one. Without a 2nd probe (OVBSC), all 
+             conversions are from NTC probe 1.
+             It is called from the Timer 2 interrupt, one msec. after 
+             multiplexer() has made the AD-channels floating inputs in its
+             blank slot (ADC_SETTLE), while all LEDs are off.
+ Variables : -
+  Returns  : -
   ---------------------------------------------------------------------------*/
-uint16_t read_adc(uint8_t ch)
+void adc_start(void)
 {
-    uint16_t result1 = 0; // conversion result
-    uint16_t result2 = 0; // sum of results
-    uint8_t  i,resultL;
-    
     // From the STM8 Reference Manual:
     // When the ADC is powered on, the digital input and output stages of the selected channel
     // are disabled independently on the GPIO pin configuration. It is therefore recommended to
     // select the analog input channel before powering on the ADC
     // Time needed: tSTAB = 7 us, tCONV = 3.5 us (fADC = 4 MHz). Total = 10.5 us)
-    ADC1.CSR.reg.CH    = ch;         // Select ADC channel
+    adc_sum[0] = 0;
+#if (ADC_PROBES > 1)
+    adc_sum[1] = 0;
+#endif
+    adc_cnt   = (uint8_t)ADC_CONV;   // 256 is 0 here, --adc_cnt still counts 256 conversions
+    adc_probe = 0;
+    adc_state = ADC_BUSY;
+    ADC1.CSR.reg.CH    = AD_NTC1;    // Select ADC channel
     ADC1.TDR.byteL      = 0x18;       // Disable Schmitt-Trigger of ADC channels 3 and 4
     ADC1.CR1.reg.ADON  = 1;          // Turn ADC on, note a 2nd set is required to start the conversion.
     ADC1.CR3.reg.DBUF  = 0;
     ADC1.CR2.reg.ALIGN = 1;          // Data is right aligned.
     while (ADC1.CR1.reg.ADON == 0) ; // wait until ADC is turned on
+    ADC1.CSR.reg.EOC   = 0;          // Reset conversion complete flag
+    ADC1.CSR.reg.EOCIE = 1;          // Enable interrupt at end of conversion
+    ADC1.CR1.reg.ADON  = 1;          // This 2nd write starts the conversion.
+} // adc_start()
 
-    for (i = 0; i < ADC_AVG; i++)
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine is called from the ADC end-of-conversion interrupt.
+             It adds the conversion result to adc_sum[] of the probe and 
+             starts the next conversion, on the other probe. After ADC_CONV
+             conversions, the ADC is disabled, the AD-channels are made 
+             outputs again and EVT_ADC_DONE is posted. All common-cathodes 
+             are still off, multiplexer() drives the display again from
+             the next msec.
+ Variables : adc_sum, adc_cnt, adc_probe, adc_state
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void adc_isr(void)
+{
+    uint16_t result; // conversion result
+    uint8_t  resultL;
+
+    resultL  = ADC1.DR.byteL;     // With right-alignment, LSB must be read first
+    result   = ADC1.DR.byteH;     // read MSB of conversion result
+    result <<= 8;
+    result  |= resultL;           // Add LSB and MSB together
+    adc_sum[adc_probe] += result; // Add results together
+    ADC1.CSR.reg.EOC = 0;         // Reset conversion complete flag
+    if (--adc_cnt > 0)
     {
-        ADC1.CR1.reg.ADON  = 1;          // This 2nd write starts the conversion.
-        while (ADC1.CSR.reg.EOC == 0) ;  // wait until conversion is complete
-        resultL      = ADC1.DR.byteL;     // With right-alignment, LSB must be read first
-        result1      = ADC1.DR.byteH;	    // read MSB of conversion result
-        result1    <<= 8;
-        result1     |= resultL;     // Add LSB and MSB together
-        result2     += result1;     // Add results together
-        ADC1.CSR.reg.EOC  = 0;	    // Reset conversion complete flag
-    } // for
-    ADC1.CR1.reg.ADON = 0;               // Disable the ADC
-    result2     /= ADC_AVG;         // Calculate average of samples
-    return result2;
-} // read_adc()
+#if (ADC_PROBES > 1)
+        adc_probe ^= 1;           // Alternate between NTC1 and NTC2
+        ADC1.CSR.reg.CH = adc_probe ? AD_NTC2 : AD_NTC1;
+#endif
+        ADC1.CR1.reg.ADON = 1;    // Start the next conversion
+    } // if
+    else
+    {   // All conversions done
+        ADC1.CSR.reg.EOCIE = 0;   // Disable interrupt at end of conversion
+        ADC1.CR1.reg.ADON  = 0;   // Disable the ADC
+        // Since the ADC disables GPIO pins automatically, these need
+        // to be set to GPIO output pins again.
+        PORT_D.DDR.byte |= AD_CHANNELS; // Set PORT_D3 (AIN4) and PORT_D2 (AIN3) as outputs again
+        PORT_D.CR1.byte |= AD_CHANNELS; // Set PORT_D3 (AIN4) and PORT_D2 (AIN3) to Push-Pull again
+        adc_state = ADC_IDLE;
+#if defined(SCHED_STATS)
+        adc_blank_us = stats_timer() - adc_t0;
+        if (adc_blank_us > adc_blank_max) adc_blank_max = adc_blank_us;
+#endif
+        post_event(EVT_ADC_DONE, 0);
+    } // else
+} // adc_isr()
+
+#if defined(ADC_MEDIAN)
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine is the median-of-3 prefilter of a probe. It stores
+             a new ADC-value in the ring-buffer of the probe and returns the
+             median of the last 3 values, so that a single spike (e.g. from
+             a relay switching) never reaches the IIR filter. It costs one
+             sample of extra delay.
+ Variables : probe: 0 = NTC probe 1, 1 = NTC probe 2
+             x    : the new ADC-value, 16-bit full-scale
+  Returns  : the median of the last 3 ADC-values of the probe
+  ---------------------------------------------------------------------------*/
+uint16_t median3(uint8_t probe, uint16_t x)
+{
+    uint16_t *p = med_buf[probe];
+    uint16_t a, b, c;
+
+    p[med_idx[probe]] = x;
+    if (++med_idx[probe] > 2) med_idx[probe] = 0;
+    a = p[0]; b = p[1]; c = p[2];
+    if (a > b)
+    {   // make a <= b
+        a = p[1];
+        b = p[0];
+    } // if
+    if (b > c) b = c;        // b = min(max(a,b),c)
+    return (a > b) ? a : b;  // median = max(min(a,b), min(max(a,b),c))
+} // median3()
+#endif
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine is the IIR filter of a probe. The filter value is 
+             the ADC-value << FILTER_SHIFT, it is updated with:
+             y[k] = y[k-1] + (x[k] - y[k-1]) / 2^shift
+             With shift = FILTER_SHIFT this is the original filter. With
+             ADC_ADAPTIVE, shift is decremented (down to FILTER_SHIFT_MIN)
+             for every sample that differs more than FILTER_THRESHOLD from
+             the filter value and incremented again for every sample that
+             does not. A real temperature change then settles in about 15 
+             instead of 250 samples, while noise is filtered as before.
+ Variables : filt : the filter value of the probe, 16-bit full-scale << FILTER_SHIFT
+             shift: the current shift of the probe
+             x    : the new ADC-value, 16-bit full-scale
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void ad_filter(uint32_t *filt, uint8_t *shift, uint16_t x)
+{
+    int32_t e = ((int32_t)x << FILTER_SHIFT) - (int32_t)*filt; // innovation
+
+#if defined(ADC_ADAPTIVE)
+    if ((e > ((int32_t)FILTER_THRESHOLD << FILTER_SHIFT)) || 
+        (e < -((int32_t)FILTER_THRESHOLD << FILTER_SHIFT)))
+    {   // real change: faster filter
+        if (*shift > FILTER_SHIFT_MIN) (*shift)--;
+    } // if
+    else if (*shift < FILTER_SHIFT) (*shift)++; // steady-state: slower filter
+#endif
+    if (e < 0) *filt -= (uint32_t)(-e) >> *shift;
+    else       *filt += (uint32_t)e >> *shift;
+} // ad_filter()
 
 /*-----------------------------------------------------------------------------
   Purpose  : This routine converts the result from the ADC into a temperature.
              Since the NTC resistance is highly non-linear, a lookup table is
              used to make calculations less intensive.
- Variables : adfilter: the value read from the ADC
+             The upper NTC_TABLE_BITS of adfilter select a table entry, 
+             the other bits are used to interpolate linearly to the next 
+             entry. For a 32-entry table:
+             temp = (1024 + 10 * (2048 * L[b] + a * (L[b+1] - L[b]))) / 2048
+             For the last entry (always out-of-limits) there is no next 
+             entry, L[b] is returned. The result is always in C,
+             value_to_led() converts it to F for the display.
+ Variables : adfilter: the filtered ADC-value, 16-bit full-scale
                  *err: true = the ADC value is out-of-limits
-  Returns  : the value read from the ADC
+  Returns  : the temperature in E-2 C
   ---------------------------------------------------------------------------*/
 int16_t ad_to_temp(uint16_t adfilter, bool *err)
 {
-	uint8_t i;
-	long    temp = 32;
-	uint8_t a = ((adfilter >> (FILTER_SHIFT-1)) & 0x3f); // Lower 6 bits
-	uint8_t b = ((adfilter >> (FILTER_SHIFT+5)) & 0x1f); // Upper 5 bits
-	uint8_t adfilter_l = adfilter >> 8;
+	int32_t  temp;
+	uint16_t a = (adfilter & NTC_MASK_A);   // Lower bits
+	uint8_t  b = (adfilter >> NTC_SHIFT_B); // Upper bits
+	uint8_t  adfilter_l = adfilter >> 8;
 
 	if ((adfilter_l >= 248) || (adfilter_l <= 8)) 
 	     *err = true;
         else *err = false;
 	// Interpolate between lookup table points
-	for (i = 0; i < 64; i++) 
-        {
-            if(a <= i) temp += (fahrenheit ? ad_lookup_f[b]   : ad_lookup_c[b]);
-	    else       temp += (fahrenheit ? ad_lookup_f[b+1] : ad_lookup_c[b+1]);
-	} // for
-	return (temp >> 6); // Divide by 64 to get back to normal temperature
+	temp = (int32_t)ad_lookup_c[b] << NTC_SHIFT_B; // 2048 * L[b]
+	if (b < NTC_TABLE_SIZE - 1) temp += (int32_t)a * (ad_lookup_c[b+1] - ad_lookup_c[b]);
+	// E-1 to E-2 C, divide by 2048 with rounding
+	return (int16_t)((temp * 10 + (1L << (NTC_SHIFT_B - 1))) >> NTC_SHIFT_B);
 } // ad_to_temp()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine returns the correction for the temperature of a 
+             probe from its calibration curve: the corrections at 0, 50 and 100 C, stored
+             as 3 consecutive parameters in EEPROM. In between two points, 
+             the correction is interpolated linearly, below 0 C and above
+             100 C the correction at 0 C resp. 100 C is used.
+             The division by CAL_STEP (500) is done as a multiplication
+             by 131/256, which gives a fraction in 1/256 units.
+             The corrections are read from their RAM copy in cfg, this 
+             routine is called for every ADC-sample.
+  Variables: temp: the temperature in E-1 C from ad_to_temp()
+             cal : the corrections at 0, 50 and 100 C, e.g. &cfg.C0
+  Returns  : the correction in E-1 C
+  ---------------------------------------------------------------------------*/
+int16_t temp_correction(int16_t temp, const int16_t *cal)
+{
+    int16_t c_lo, c_hi;
+    int16_t x = temp;
+
+    if (x >= CAL_STEP)
+    {   // Use the corrections at 50 and 100 C
+        cal++;
+        x -= CAL_STEP;
+    } // if
+    c_lo = cal[0];
+    c_hi = cal[1];
+    if (x <= 0)        return c_lo; // below 0 C
+    if (x >= CAL_STEP) return c_hi; // above 100 C
+    x = ((uint16_t)x * 131) >> 8; // x / 500 in 1/256 units [0..255]
+    return c_lo + (((c_hi - c_lo) * x + 128) >> 8);
+} // temp_correction()
@@ -29,16 +29,60 @@
 #include "stm8as.h"
 
 #include "stc1000p.h"
+#include "scheduler.h"
 
 // NTC1 is connected to ADC-channel AIN4 (PD3)
 // NTC2 is connected to ADC-channel AIN3 (PD2)
 #define AD_NTC1 (0x04)
 #define AD_NTC2 (0x03)
 
-#define FILTER_SHIFT  (6)
-#define ADC_AVG      (16)
+#define FILTER_SHIFT  (6)                          // IIR: y[k] = y[k-1] - y[k-1]/64 + x[k]
+#define FILTER_SHIFT_MIN (2)                       // ADC_ADAPTIVE: fastest time-constant, 4 samples
+#define FILTER_THRESHOLD (64)                      // ADC_ADAPTIVE: about 4 x noise, 0.1 C at 25 C
+#define AD_MID_SCALE  (0x8000L << FILTER_SHIFT)  // start value of ad_ntc1 and ad_ntc2
+
+// Values for adc_state, the acquisition of the NTC probes
+#define ADC_IDLE      (0) // no conversions
+#define ADC_REQUEST   (1) // set by adc_task(), multiplexer() adds a blank slot
+#define ADC_SETTLE    (2) // AD-channels are inputs, conversions start at the next msec.
+#define ADC_BUSY      (3) // conversions running, adc_isr() sets ADC_IDLE when done
+
+#if defined(OVBSC)
+    #define ADC_PROBES (1)  // NTC probe 1 only
+#else
+    #define ADC_PROBES (2)  // conversions alternate between NTC probe 1 and 2
+#endif
+#define ADC_CONV      (1 << (ADC_OS_BITS << 1))            // 4^ADC_OS_BITS conversions per adc_task()
+#define ADC_AVG       (ADC_CONV / ADC_PROBES)              // conversions per probe
+#define ADC_SUM_BITS  (10 + (ADC_OS_BITS << 1) + 1 - ADC_PROBES) // bits in adc_sum[]
+
+// Sum of ADC_AVG conversions to a 16-bit full-scale ADC-value
+#if (ADC_SUM_BITS > 16)
+    typedef uint32_t adc_sum_t;
+    #define ADC_SUM_TO_FS(s) ((uint16_t)((s) >> (ADC_SUM_BITS - 16)))
+#else
+    typedef uint16_t adc_sum_t;
+    #define ADC_SUM_TO_FS(s) ((uint16_t)(s) << (16 - ADC_SUM_BITS))
+#endif
+
+// ad_to_temp(): table index and interpolation bits, NTC_TABLE_BITS is set in ntc_table.h
+#define NTC_TABLE_SIZE (1 << NTC_TABLE_BITS)
+#define NTC_SHIFT_B    (16 - NTC_TABLE_BITS)  // 11 for 32 entries
+#define NTC_MASK_A     ((1U << NTC_SHIFT_B) - 1)
+
+// Round a temperature in E-2 C to E-1 C
+#define E2_TO_E1(x)    (((x) + (((x) < 0) ? -5 : 5)) / 10)
+
+// temp_correction(): calibration points at 0, 50 and 100 C
+#define CAL_STEP       (500)  // E-1 C between two calibration points
 
 // Function prototypes
-uint16_t read_adc(uint8_t ch);
+void     adc_start(void);
+void     adc_isr(void);
+void     ad_filter(uint32_t *filt, uint8_t *shift, uint16_t x);
 int16_t  ad_to_temp(uint16_t adfilter, bool *err);
+int16_t  temp_correction(int16_t temp, const int16_t *cal);
+#if defined(ADC_MEDIAN)
+uint16_t median3(uint8_t probe, uint16_t x);
+#endif
 #endif
@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""==================================================================
+  File Name    : eeprom_image.py
+  ------------------------------------------------------------------
+  Purpose : Generates build/eeprom.ihx, the EEPROM image with the
+            default configuration, or checks an existing image.
+            The layout is the same as written by config_load() in
+            eep.c: the profiles, the menu-items with their MENU_DATA
+            default value, the power-on flag, an empty journal, the
+            header (magic, layout, CRC-16) and an empty ring. Every word
+            is stored MSB first, like eeprom_read() expects.
+            The profiles are DEFAULT_PROFILES, the example profiles of
+            the image before the header (git 2ff1fb1). They are kept
+            only for the geometry they were made for, NO_OF_PROFILES 4
+            and NO_OF_TT_PAIRS 5; with another geometry the profiles
+            are cleared, as config_defaults() does.
+            MENU_DATA, NO_OF_PROFILES, NO_OF_TT_PAIRS, EEADR_HEADER,
+            EEP_MAGIC and the EEPROM version are read from
+            src/stc1000p_lib.h and src/stc1000p.h.
+            --bitflip flips every bit of the configuration area and the
+            header of the default image, one at a time, and checks that
+            config_load() would reject every flipped image (or only
+            repair the magic).
+
+            Examples:
+              eeprom_image.py
+              eeprom_image.py --ovbsc -o build/eeprom_ovbsc.ihx
+              eeprom_image.py --check build/eeprom.ihx
+              eeprom_image.py --bitflip
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+"""
+import argparse
+import os
+import re
+import sys
+
+SRC          = os.path.join(os.path.dirname(__file__), '..', 'src')
+EEP_BASE     = 0x4000
+EEPROM_SIZE  = 640
+
+
+def read_src(name):
+    with open(os.path.join(SRC, name), encoding='latin-1') as f:
+        return f.read()
+
+
+def define(text, name):
+    """Value of '#define name (value)' that is not commented out."""
+    m = re.search(r'^\s*#define\s+%s\s+\(?\s*(0x[0-9a-fA-F]+|\d+)\s*\)?' % name, text, re.M)
+    if not m:
+        sys.exit('%s not found' % name)
+    return int(m.group(1), 0)
+
+
+LIB          = read_src('stc1000p_lib.h')
+EEADR_HEADER = define(LIB, 'EEADR_HEADER')
+EEP_MAGIC    = define(LIB, 'EEP_MAGIC')
+
+# Example profiles of the image before the header, for 4 profiles of 5
+# (setpoint, duration) pairs and a final setpoint: setpoints in 0.1 C,
+# durations in hours, duration 0 ends the profile.
+DEFAULT_PROFILES_GEOMETRY = (4, 5)
+DEFAULT_PROFILES = [
+    [110, 504, 110,   6, 160,  72, 160, 12, 60, 0, 0],
+    [190,  72, 190,  12, 210, 504, 210, 12, 60, 0, 0],
+    [200,  72, 200,  12, 220, 504, 220, 12, 60, 0, 0],
+    [180, 564, 180,  12,  60,   0,   0,  0,  0, 0, 0],
+]
+
+
+def menu_data(text, ovbsc):
+    """(name, default value) of every menu-item in MENU_DATA."""
+    blocks = re.findall(r'#define MENU_DATA\(_\)(.*?)(?:\n#else|\n#endif)', text, re.S)
+    block  = blocks[0] if ovbsc else blocks[1]  # OVBSC first, see stc1000p_lib.h
+    items  = re.findall(r'_\(\s*(\w+)\s*,[^)]*,\s*([\w-]+)\s*\)', block)
+    return items
+
+
+def crc16(words):
+    """CRC-16 CCITT (0x1021, initial value 0xFFFF), MSB first, as eeprom_crc()."""
+    crc = 0xffff
+    for w in words:
+        for j in range(16):
+            if (crc ^ w) & 0x8000:
+                crc = ((crc << 1) ^ 0x1021) & 0xffff
+            else:
+                crc = (crc << 1) & 0xffff
+            w <<= 1
+    return crc
+
+
+def layout(args):
+    """Configuration area size and EEP_LAYOUT."""
+    version  = define(read_src('stc1000p.h'), 'STC1000P_EEPROM_VERSION')
+    profiles = define(LIB, 'NO_OF_PROFILES')
+    pairs    = define(LIB, 'NO_OF_TT_PAIRS')
+    items    = menu_data(LIB, args.ovbsc)
+    if args.ovbsc:
+        return 0, items, version << 8
+    return profiles * (2 * pairs + 1), items, (version << 8) | (profiles << 4) | pairs
+
+
+def make_image(args):
+    menu, items, lay = layout(args)
+    consts = {'NO_OF_PROFILES': define(LIB, 'NO_OF_PROFILES')}
+    words  = [0] * (EEPROM_SIZE // 2)
+    if not args.ovbsc:
+        geometry = (define(LIB, 'NO_OF_PROFILES'), define(LIB, 'NO_OF_TT_PAIRS'))
+        if geometry == DEFAULT_PROFILES_GEOMETRY:
+            words[:menu] = sum(DEFAULT_PROFILES, [])
+        else:
+            print('%d profiles of %d pairs: DEFAULT_PROFILES are for %d of %d, profiles cleared'
+                  % (geometry + DEFAULT_PROFILES_GEOMETRY))
+    for i, (name, default) in enumerate(items):
+        words[menu + i] = int(consts.get(default, default)) & 0xffff
+    if not args.ovbsc:
+        words[menu + len(items)] = 1  # power-on flag
+    end = menu + len(items)
+    words[EEADR_HEADER:EEADR_HEADER + 3] = [EEP_MAGIC, lay, crc16(words[:end])]
+    data = bytearray()
+    for w in words:
+        data += bytes([w >> 8, w & 0xff])
+    return data
+
+
+def write_ihx(path, data):
+    with open(path, 'w') as f:
+        for ofs in range(0, len(data), 32):
+            rec = bytes([32, (EEP_BASE + ofs) >> 8, (EEP_BASE + ofs) & 0xff, 0]) + data[ofs:ofs + 32]
+            f.write(':%s%02X\n' % (rec.hex().upper(), (-sum(rec)) & 0xff))
+        f.write(':00000001FF\n')
+
+
+def read_ihx(path):
+    data = bytearray(EEPROM_SIZE)
+    with open(path) as f:
+        for line in f:
+            rec = bytes.fromhex(line.strip()[1:])
+            if sum(rec) & 0xff:
+                sys.exit('%s: checksum error in record %s' % (path, line.strip()))
+            if rec[3] == 0:
+                adr = ((rec[1] << 8) | rec[2]) - EEP_BASE
+                data[adr:adr + rec[0]] = rec[4:4 + rec[0]]
+    return data
+
+
+def to_words(data):
+    return [(data[2 * i] << 8) | data[2 * i + 1] for i in range(len(data) // 2)]
+
+
+def check_words(words, end, lay):
+    """Same check as config_check() in eep.c for an image with a header:
+    (True, message) if config_load() uses the image as it is."""
+    hdr = words[EEADR_HEADER:EEADR_HEADER + 3]
+    crc = crc16(words[:end])
+    if hdr[0] != EEP_MAGIC:
+        if hdr[1] == lay and hdr[2] == crc:
+            return True, 'magic corrupted, config_load() repairs it'
+        return False, 'no header, config_load() checks it as a layout 20 image'
+    if hdr[1] != lay:
+        return False, 'layout 0x%04X, current is 0x%04X, config_load() migrates it' % (hdr[1], lay)
+    if hdr[2] != crc:
+        return False, 'CRC error, config_load() uses the default values'
+    return True, 'valid, layout 0x%04X, CRC 0x%04X' % (lay, hdr[2])
+
+
+def check_image(args):
+    menu, items, lay = layout(args)
+    ok, msg = check_words(to_words(read_ihx(args.check)), menu + len(items), lay)
+    print('%s: %s' % (args.check, msg))
+    return 0 if ok else 1
+
+
+def bitflip(args):
+    """Flips every bit of the configuration area and the header of the
+    default image: only a flipped magic may be accepted."""
+    menu, items, lay = layout(args)
+    words = to_words(make_image(args))
+    end   = menu + len(items)
+    fails = 0
+    for adr in list(range(end)) + list(range(EEADR_HEADER, EEADR_HEADER + 3)):
+        for bit in range(16):
+            w = list(words)
+            w[adr] ^= 1 << bit
+            ok, msg = check_words(w, end, lay)
+            if ok != (adr == EEADR_HEADER):
+                print('word %d, bit %d: %s' % (adr, bit, msg))
+                fails += 1
+    print('%d bit-flips, %d not detected' % (16 * (end + 3), fails))
+    return 1 if fails else 0
+
+
+def main():
+    p = argparse.ArgumentParser(description='Generate or check the EEPROM image')
+    p.add_argument('--ovbsc', action='store_true', help='Image for the OVBSC build')
+    p.add_argument('--check', metavar='IHX', help='Check an image instead of generating one')
+    p.add_argument('--bitflip', action='store_true', help='Check that every flipped bit of the default image is detected')
+    p.add_argument('-o', '--output', default=os.path.join(os.path.dirname(__file__), '..', 'build', 'eeprom.ihx'),
+                   help='Output Intel-hex file')
+    args = p.parse_args()
+
+    if args.check:
+        return check_image(args)
+    if args.bitflip:
+        return bitflip(args)
+    write_ihx(args.output, make_image(args))
+    print('%s: %d bytes' % (args.output, EEPROM_SIZE))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
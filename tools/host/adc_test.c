@@ -0,0 +1,450 @@
+/*==================================================================
+  File Name    : adc_test.c
+  ------------------------------------------------------------------
+  Purpose : Host test of the ADC pipeline of src/: the sums of the
+            conversions of adc_isr() go through adc_done(), which scales
+            them to 16-bit full-scale, filters them with ad_filter()
+            (median3() first with ADC_MEDIAN), converts them with
+            ad_to_temp() and corrects them with temp_correction() and
+            the offset tc. It checks that:
+            - temp_correction() gives the calibration points C0, C5 and
+              C1 at 0, 50 and 100 C, the linear interpolation in between
+              (within 0.1 C) and the end points outside 0..100 C;
+            - known conversion results for both probes give the
+              calibrated temperature at and between the 3 points, in
+              E-2 C (temp_ntc1_e2) and E-1 C (temp_ntc1, temp_ntc2);
+            - oversampling: every sum of ADC_AVG conversions gives the
+              E-2 temperature of their mean within 0.01 C, it is the
+              temperature of the E-1 path (git 0c78b92^: the mean
+              truncated to 10 bits, ad_to_temp() in E-1 C) for a whole
+              mean and lies between the whole means for a fraction;
+            - spikes: a single-sample spike every 10 samples, on top of a
+              noisy input, through adc_done(). With ADC_MEDIAN (target
+              adc_test_median), median3() equals a sorted median and no
+              spike reaches the IIR filter. Without it, the deviation of
+              the IIR filter alone is reported;
+            - filter: a 3 C step with gaussian noise straight into 
+              ad_filter(), against the fixed IIR filter (FILTER_SHIFT).
+              With ADC_ADAPTIVE the filter must settle at least 4 times
+              faster with no more than 20 % more noise at the nominal
+              noise of 16 codes (FILTER_THRESHOLD / 4).
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "stm8as.h"
+
+#undef  ASM
+#define ASM(mnem)          // no STM8 instructions on the host
+#define main stc1000p_main // main() of the firmware is not used
+
+#include "stc1000p.c"
+#undef  main
+#include "stc1000p_lib.c"
+#include "scheduler.c"
+#include "eep.c"
+#include "temp.c"
+#include "pid.c"
+#if defined(OVBSC)
+#include "ovbsc.c"
+#endif
+
+#define SETTLE (2000) // adc_done() calls until the IIR filter has settled
+#define SPIKES (100)  // single-sample spikes per run of spike_test()
+#define NOISE  (16)   // nominal noise in codes rms, FILTER_THRESHOLD / 4
+#define STEADY (5000) // samples for the noise of the filter
+
+int fails = 0;
+
+#define FAIL(...) do { if (fails++ < 10) printf(__VA_ARGS__); } while (0)
+
+// Calibration points (E-1 C) at 0, 50 and 100 C and the offset per probe
+const int16_t cal1[3] = { 12, -7, 25 }, tc_1 = 3;
+const int16_t cal2[3] = { -20, 15, -4 }, tc_2 = -6;
+
+/*-----------------------------------------------------------------------------
+  Purpose  : The exact calibration curve: linear between the points, the
+             end points outside 0..100 C.
+  Variables: temp: the temperature in E-1 C
+             cal : the corrections at 0, 50 and 100 C
+  Returns  : the correction in E-1 C
+  ---------------------------------------------------------------------------*/
+double cal_exact(int16_t temp, const int16_t *cal)
+{
+    if (temp <= 0)            return cal[0];
+    if (temp >= 2 * CAL_STEP) return cal[2];
+    if (temp >= CAL_STEP)     return cal[1] + (double)(cal[2] - cal[1]) * (temp - CAL_STEP) / CAL_STEP;
+    return cal[0] + (double)(cal[1] - cal[0]) * temp / CAL_STEP;
+} // cal_exact()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function tests temp_correction() from -40 to 150 C.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void cal_test(void)
+{
+    int16_t t, c, i;
+
+    for (i = 0; i < 3; i++)
+    {   // exactly the calibration points
+        if ((c = temp_correction(i * CAL_STEP, cal1)) != cal1[i])
+            FAIL("correction at %d C: %d instead of %d\n", i * CAL_STEP / 10, c, cal1[i]);
+    } // for
+    for (t = -400; t <= 1500; t++)
+    {
+        c = temp_correction(t, cal1);
+        if (fabs(c - cal_exact(t, cal1)) > 1.0)
+            FAIL("correction at %d E-1 C: %d, exact %.2f\n", t, c, cal_exact(t, cal1));
+    } // for
+} // cal_test()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : ad_to_temp() and the scaling of adc_done() before 0c78b92: the
+             sum is divided by ADC_AVG, the settled filter is 64 times
+             that and only 6 bits are used for the interpolation.
+  Variables: sum: the sum of ADC_AVG conversions
+  Returns  : the temperature in E-1 C
+  ---------------------------------------------------------------------------*/
+int16_t ad_to_temp_e1(adc_sum_t sum)
+{
+    uint16_t adfilter = (sum / ADC_AVG) << 6;
+    uint8_t  a = (adfilter >> 5) & 0x3f;
+    uint8_t  b = adfilter >> 11;
+    int32_t  temp = ((int32_t)ad_lookup_c[b] << 6) + 32;
+
+    if (b < NTC_TABLE_SIZE - 1) temp += (int32_t)a * (ad_lookup_c[b+1] - ad_lookup_c[b]);
+    return (int16_t)(temp >> 6);
+} // ad_to_temp_e1()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function feeds every sum of ADC_AVG conversions within
+             the limits into ad_to_temp(), as adc_done() does, and compares 
+             it with the exact temperature of the mean of the conversions 
+             and with the E-1 path.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void os_test(void)
+{
+    adc_sum_t s;
+    int16_t   t2, t1, t2_lo, t2_hi;
+    double    fs, exact, err2 = 0, err1 = 0;
+    long      n = 0, same = 0;
+    uint8_t   b;
+    bool      err;
+
+    for (s = 0; s < (adc_sum_t)ADC_AVG * 1023; s++)
+    {
+        t2 = ad_to_temp(ADC_SUM_TO_FS(s), &err);
+        if (err) continue;
+        n++;
+        fs    = 64.0 * s / ADC_AVG; // mean of the conversions, 16-bit full-scale
+        b     = (uint8_t)(fs / (1 << NTC_SHIFT_B));
+        exact = 10.0 * (ad_lookup_c[b] + (fs - b * (1 << NTC_SHIFT_B)) * 
+                        (ad_lookup_c[b+1] - ad_lookup_c[b]) / (1 << NTC_SHIFT_B));
+        if (fabs(t2 - exact) > err2) err2 = fabs(t2 - exact);
+        t1 = ad_to_temp_e1(s);
+        if (fabs(10.0 * t1 - exact) > err1) err1 = fabs(10.0 * t1 - exact);
+        if (fabs(t2 - exact) > 0.5 + 1e-6)
+            FAIL("sum %lu: %d E-2 C, exact %.2f\n", (unsigned long)s, t2, exact);
+        t2_lo = ad_to_temp(ADC_SUM_TO_FS(s - s % ADC_AVG), &err);
+        t2_hi = ad_to_temp(ADC_SUM_TO_FS(s - s % ADC_AVG + ADC_AVG), &err);
+        if (s % ADC_AVG)
+        {   // a fraction: between the whole means
+            if ((t2 < t2_lo) || (t2 > t2_hi))
+                FAIL("sum %lu: %d E-2 C not within %d..%d\n", (unsigned long)s, t2, t2_lo, t2_hi);
+        } // if
+        else if (E2_TO_E1(t2) == t1) same++;
+        else if (abs(E2_TO_E1(t2) - t1) > 1)
+            FAIL("sum %lu: %d E-2 C, E-1 path %d\n", (unsigned long)s, t2, t1);
+    } // for
+    printf("oversampling: %ld sums of %d conversions, %ld of %ld whole means equal to the E-1 path\n",
+           n, ADC_AVG, same, n / ADC_AVG);
+    printf("              error of the mean: E-2 path %.3f C, E-1 path %.3f C\n", err2 / 100, err1 / 100);
+} // os_test()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function returns the 10-bit conversion result for which
+             ad_to_temp() is nearest to a temperature, within the limits.
+  Variables: temp: the temperature in E-2 C
+  Returns  : the conversion result
+  ---------------------------------------------------------------------------*/
+uint16_t ad_value(int16_t temp)
+{
+    uint16_t r, best = 0;
+    int      d, d_best = 32767;
+    bool     err;
+
+    for (r = 0; r < 1024; r++)
+    {
+        d = abs(ad_to_temp(ADC_SUM_TO_FS((adc_sum_t)ADC_AVG * r), &err) - temp);
+        if (!err && (d < d_best))
+        {
+            d_best = d;
+            best   = r;
+        } // if
+    } // for
+    return best;
+} // ad_value()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function runs adc_done() with the same conversion results
+             until the filters have settled and compares the temperatures
+             with the calibrated temperature of the conversion results.
+  Variables: temp: the temperature in E-2 C, before calibration
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void pipeline(int16_t temp)
+{
+    uint16_t r = ad_value(temp);
+    int16_t  raw, i;
+    double   exp1, exp2;
+    bool     err;
+
+    ad_ntc1 = ad_ntc2 = AD_MID_SCALE;
+    ad_shift1 = ad_shift2 = FILTER_SHIFT;
+    for (i = 0; i < SETTLE; i++)
+    {
+        adc_sum[0] = (adc_sum_t)ADC_AVG * r;
+#if !(defined(OVBSC))
+        adc_sum[1] = (adc_sum_t)ADC_AVG * r;
+#endif
+        adc_done(0);
+    } // for
+    raw  = ad_to_temp(ADC_SUM_TO_FS((adc_sum_t)ADC_AVG * r), &err);
+    exp1 = raw + 10.0 * (cal_exact(raw / 10, cal1) + tc_1);
+    exp2 = raw + 10.0 * (cal_exact(raw / 10, cal2) + tc_2);
+    if (fabs(temp_ntc1_e2 - exp1) > 10.0)
+        FAIL("probe 1, %d: %d E-2 C instead of %.1f\n", r, temp_ntc1_e2, exp1);
+    if (abs(temp_ntc1 - E2_TO_E1(temp_ntc1_e2)) > 0)
+        FAIL("probe 1, %d: %d E-1 C, %d E-2 C\n", r, temp_ntc1, temp_ntc1_e2);
+#if !(defined(OVBSC))
+    if (fabs(10.0 * temp_ntc2 - exp2) > 15.0)
+        FAIL("probe 2, %d: %d E-1 C instead of %.1f E-2 C\n", r, temp_ntc2, exp2);
+#else
+    (void)exp2;
+#endif
+    printf("%4d: %6.2f C, probe 1 %6.2f C (exact %6.2f)", r, raw / 100.0, temp_ntc1_e2 / 100.0, exp1 / 100.0);
+#if !(defined(OVBSC))
+    printf(", probe 2 %5.1f C (exact %6.2f)", temp_ntc2 / 10.0, exp2 / 100.0);
+#endif
+    printf("\n");
+} // pipeline()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function runs adc_done() for probe 1 with a 10-bit 
+             conversion result plus noise of +/- 2 conversion results in 
+             the sum, and replaces one sum out of every gap by a spike.
+  Variables: r    : the conversion result
+             spike: the sum of a spike
+             gap  : the number of samples from one spike to the next
+  Returns  : the largest deviation of temp_ntc1_e2 after the filter has
+             settled, in E-2 C
+  ---------------------------------------------------------------------------*/
+int16_t spike_run(uint16_t r, adc_sum_t spike, int gap)
+{
+    int16_t t0 = 0, d, d_max = 0;
+    int     i;
+
+    ad_ntc1   = AD_MID_SCALE;
+    ad_shift1 = FILTER_SHIFT;
+    srand(r);
+    for (i = 0; i < SETTLE + gap * SPIKES; i++)
+    {
+        adc_sum[0] = (adc_sum_t)ADC_AVG * r + (rand() % 5) - 2;
+        if ((i >= SETTLE) && (i % gap == gap / 2)) adc_sum[0] = spike;
+        adc_done(0);
+        if (i == SETTLE - 1) t0 = temp_ntc1_e2;
+        if (i < SETTLE) continue;
+        d = abs(temp_ntc1_e2 - t0);
+        if (d > d_max) d_max = d;
+    } // for
+    return d_max;
+} // spike_run()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function injects spikes of 0 and full-scale at -10, 25 
+             and 100 C, isolated (every 100 samples) and repeated (every 10 
+             samples). With ADC_MEDIAN, it first compares median3() with a
+             sorted median for every triple of 4-bit values.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void spike_test(void)
+{
+    const int16_t temps[] = { -1000, 2500, 10000 };
+    const int     gaps[]  = { 100, 10 };
+    uint16_t r, m;
+    int16_t  d_no, d[2];
+    uint8_t  i, j;
+#if defined(ADC_MEDIAN)
+    uint16_t x[3], s[3], k;
+
+    for (k = 0; k < 4096; k++)
+    {
+        for (i = 0; i < 3; i++) x[i] = s[i] = ((k >> (4 * i)) & 0x0f) << 12;
+        if (s[0] > s[1]) { m = s[0]; s[0] = s[1]; s[1] = m; }
+        if (s[1] > s[2]) { m = s[1]; s[1] = s[2]; s[2] = m; }
+        if (s[0] > s[1]) { m = s[0]; s[0] = s[1]; s[1] = m; }
+        for (i = 0; i < 3; i++) m = median3(1, x[i]);
+        if (m != s[1]) FAIL("median3(%u, %u, %u) = %u\n", x[0], x[1], x[2], m);
+    } // for
+#endif
+    for (i = 0; i < sizeof(temps) / sizeof(temps[0]); i++)
+    {
+        r    = ad_value(temps[i]);
+        d_no = spike_run(r, (adc_sum_t)ADC_AVG * r, 10); // noise only
+        for (j = 0; j < 2; j++)
+        {   // the larger deviation of a spike of 0 and of full-scale
+            d[j] = spike_run(r, 0, gaps[j]);
+            m    = spike_run(r, (adc_sum_t)ADC_AVG * 1023, gaps[j]);
+            if (m > d[j]) d[j] = m;
+#if defined(ADC_MEDIAN)
+            // only the noise is left: the median of 3 noisy samples is not the mean
+            if (d[j] > 2 * d_no + 1)
+                FAIL("spikes every %d samples at %d E-2 C reach the IIR filter\n", gaps[j], temps[i]);
+#endif
+        } // for
+        printf("spikes at %6.2f C: deviation %.2f C with noise only, %.2f C isolated, %.2f C every 10 samples\n", 
+               temps[i] / 100.0, d_no / 100.0, d[0] / 100.0, d[1] / 100.0);
+    } // for
+} // spike_test()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function returns the 16-bit full-scale ADC-value for 
+             which ad_to_temp() is nearest to a temperature.
+  Variables: temp: the temperature in E-2 C
+  Returns  : the ADC-value
+  ---------------------------------------------------------------------------*/
+uint16_t fs_value(int16_t temp)
+{
+    long x;
+    bool err;
+
+    for (x = 0; x < 0xffffL; x++) if (ad_to_temp(x, &err) >= temp) break;
+    return (uint16_t)x;
+} // fs_value()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function returns gaussian noise (Box-Muller).
+  Variables: rms: the rms value
+  Returns  : the noise, rounded
+  ---------------------------------------------------------------------------*/
+int noise(double rms)
+{
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return (int)floor(rms * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2) + 0.5);
+} // noise()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function runs a filter with a step of 3 C at 25 C plus
+             noise. fixed = true is the original IIR filter, y[k] = y[k-1] 
+             + (x[k] - y[k-1]) / 2^FILTER_SHIFT, otherwise ad_filter().
+  Variables: fixed: true = original IIR filter
+             rms  : the noise in codes rms
+             *rms_out: the noise of the filter output before the step, 
+                       in codes rms
+  Returns  : the samples after the step until the output stays within 
+             0.1 C of the new temperature
+  ---------------------------------------------------------------------------*/
+int step_run(bool fixed, double rms, double *rms_out)
+{
+    uint16_t x0 = fs_value(2500), x1 = fs_value(2800), x;
+    uint32_t y  = (uint32_t)x0 << FILTER_SHIFT;
+    uint8_t  shift = FILTER_SHIFT;
+    int32_t  e;
+    double   sum2 = 0;
+    int      i, settled = 0;
+    bool     err;
+
+    srand(1);
+    for (i = -SETTLE - STEADY; i < 4 * SETTLE; i++)
+    {
+        x = ((i < 0) ? x0 : x1) + noise(rms);
+        if (fixed)
+        {
+            e = ((int32_t)x << FILTER_SHIFT) - (int32_t)y;
+            if (e < 0) y -= (uint32_t)(-e) >> FILTER_SHIFT;
+            else       y += (uint32_t)e >> FILTER_SHIFT;
+        } // if
+        else ad_filter(&y, &shift, x);
+        if ((i >= -STEADY) && (i < 0))
+            sum2 += ((double)y / (1 << FILTER_SHIFT) - x0) * ((double)y / (1 << FILTER_SHIFT) - x0);
+        if ((i >= 0) && (abs(ad_to_temp(y >> FILTER_SHIFT, &err) - 2800) > 10)) settled = i + 1;
+    } // for
+    *rms_out = sqrt(sum2 / STEADY);
+    return settled;
+} // step_run()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function compares ad_filter() with the original IIR 
+             filter for a step of 3 C, at several noise levels.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void filter_test(void)
+{
+    const int rms[] = { 8, NOISE, 24, 32 };
+    int       n_fix, n_ad, i;
+    double    r_fix, r_ad;
+
+    for (i = 0; i < (int)(sizeof(rms) / sizeof(rms[0])); i++)
+    {
+        n_fix = step_run(true,  rms[i], &r_fix);
+        n_ad  = step_run(false, rms[i], &r_ad);
+        printf("filter, noise %2d codes rms: fixed %3d samples, %.2f codes rms; ad_filter() %3d samples, %.2f codes rms\n",
+               rms[i], n_fix, r_fix, n_ad, r_ad);
+#if defined(ADC_ADAPTIVE)
+        if ((rms[i] == NOISE) && ((4 * n_ad > n_fix) || (r_ad > 1.2 * r_fix)))
+            FAIL("ad_filter(): %d samples and %.2f codes rms, fixed filter %d samples and %.2f codes rms\n",
+                 n_ad, r_ad, n_fix, r_fix);
+#endif
+    } // for
+} // filter_test()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : main() runs the tests.
+  Variables: -
+  Returns  : 0 = all passed
+  ---------------------------------------------------------------------------*/
+int main(void)
+{
+    const int16_t temps[] = { -1000, 0, 1250, 2500, 3750, 5000, 6250, 7500, 8750, 10000, 12000 };
+    uint8_t i;
+
+    cal_test();
+    os_test();
+    spike_test();
+    filter_test();
+    for (i = 0; i < 3; i++)
+    {
+        (&cfg.C0)[i]  = cal1[i];
+#if !(defined(OVBSC))
+        (&cfg.C02)[i] = cal2[i];
+#endif
+    } // for
+    cfg.tc  = tc_1;
+#if !(defined(OVBSC))
+    cfg.tc2 = tc_2;
+#endif
+    for (i = 0; i < sizeof(temps) / sizeof(temps[0]); i++) pipeline(temps[i]);
+    printf("%d failures\n", fails);
+    return fails ? 1 : 0;
+} // main()
@@ -0,0 +1,201 @@
+/*==================================================================
+  File Name    : cf_test.c
+  ------------------------------------------------------------------
+  Purpose : Host test of the display in degrees Fahrenheit: temperatures
+            are kept in E-1 degrees C, temp_to_disp() and disp_to_temp()
+            in src/stc1000p_lib.c convert them for the display and the
+            menu. It checks that:
+            - the displayed temperature of every ADC-value is the value
+              that ad_to_temp() gave with the former Fahrenheit table
+              ad_lookup_f[] (git f9dab7b^), within 0.2 F: the temperature
+              is kept in E-1 C, which is a step of 0.18 F, and the former
+              F table differs up to 0.12 F from the converted C table;
+            - for every menu temperature and every profile setpoint, in
+              C and in F, every value reached with step_config_value()
+              (the UP and DOWN buttons) is shown unchanged after it is
+              stored, both directions reach the same values and F has as
+              many values as C. A F value that is not a whole number of
+              E-1 C (68.1 F) is skipped;
+            - every C value and every default survives a switch to F and
+              back.
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "stm8as.h"
+
+#undef  ASM
+#define ASM(mnem)          // no STM8 instructions on the host
+#define main stc1000p_main // main() of the firmware is not used
+
+#include "stc1000p.c"
+#undef  main
+#include "stc1000p_lib.c"
+#include "scheduler.c"
+#include "eep.c"
+#include "temp.c"
+#include "pid.c"
+#if defined(OVBSC)
+#include "ovbsc.c"
+#endif
+
+#define MAX_STEPS (4000) // more than the values of the widest range
+
+int fails = 0;
+
+#define FAIL(...) do { if (fails++ < 10) printf(__VA_ARGS__); } while (0)
+
+// Fahrenheit table of ntc_table.h before f9dab7b, in E-1 degrees F
+const int ad_lookup_f[] = {0,-555,-319,-167,-49,48,134,211,282,348,412,474,534,593,652,711,770,831,893,957,1025,1096,1172,1253,1343,1444,1559,1694,1860,2078,2397,2987};
+
+/*-----------------------------------------------------------------------------
+  Purpose  : ad_to_temp() with ad_lookup_f[] before f9dab7b: 6 bits of
+             interpolation and the result in E-1 degrees F.
+  Variables: adfilter: the filtered ADC-value, 16-bit full-scale
+  Returns  : the temperature in E-1 degrees F
+  ---------------------------------------------------------------------------*/
+int16_t ad_to_temp_f(uint16_t adfilter)
+{
+    uint8_t a = (adfilter >> 5) & 0x3f;
+    uint8_t b = adfilter >> 11;
+    long    temp = ((long)ad_lookup_f[b] << 6) + 32;
+
+    if (b < NTC_TABLE_SIZE - 1) temp += (long)a * (ad_lookup_f[b+1] - ad_lookup_f[b]);
+    return (int16_t)(temp >> 6);
+} // ad_to_temp_f()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function compares the displayed F temperature with the
+             former F table for every ADC-value within the limits, where
+             the 6-bit interpolation of the former ad_to_temp() is exact.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void table_test(void)
+{
+    long    x;
+    int16_t f_old, f_new;
+    int     n = 0, diff[3] = {0};
+    bool    err;
+
+    fahrenheit = true;
+    for (x = 0; x < 0x10000L; x += 32)
+    {
+        f_new = temp_to_disp(E2_TO_E1(ad_to_temp(x, &err)), TEMP_ABS);
+        if (err) continue; // not displayed
+        f_old = ad_to_temp_f(x);
+        n++;
+        if (abs(f_new - f_old) <= 2) diff[abs(f_new - f_old)]++;
+        else FAIL("adfilter 0x%04lx: %d E-1 F instead of %d\n", x, f_new, f_old);
+    } // for
+    printf("F table: %d ADC-values, %d equal, %d differ 0.1 F, %d differ 0.2 F\n", n, diff[0], diff[1], diff[2]);
+} // table_test()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function steps through all values of a parameter with
+             step_config_value(), like the UP or DOWN button in the menu,
+             until it rolls over to the first value again. Every value is
+             stored with disp_to_temp() and shown again with temp_to_disp().
+  Variables: eeadr: the number of the parameter in EEPROM
+             step : +1 (UP) or -1 (DOWN)
+  Returns  : the number of values
+  ---------------------------------------------------------------------------*/
+int walk(uint8_t eeadr, int8_t step)
+{
+    uint8_t kind = config_temp_type(eeadr);
+    int16_t v, v0, w;
+    int     n = 0;
+
+    v0 = v = temp_to_disp(0, kind); // 0 C can be stored in both units
+    do
+    {
+        w = temp_to_disp(disp_to_temp(v, kind), kind);
+        if (w != v)
+            FAIL("eeadr %d, %c: %d shown as %d after it is stored\n", eeadr, fahrenheit ? 'F' : 'C', v, w);
+        if (check_config_value(v, eeadr) != v)
+            FAIL("eeadr %d, %c: %d out of range\n", eeadr, fahrenheit ? 'F' : 'C', v);
+        w = step_config_value(v, 10 * step, eeadr); // accelerated
+        if (temp_to_disp(disp_to_temp(w, kind), kind) != w)
+            FAIL("eeadr %d, %c: %d + %d gives %d, not stored exactly\n", eeadr, fahrenheit ? 'F' : 'C', v, 10 * step, w);
+        v = step_config_value(v, step, eeadr);
+    } while ((v != v0) && (++n < MAX_STEPS));
+    return n + 1;
+} // walk()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function tests all temperature parameters in both units.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void menu_test(void)
+{
+    uint8_t eeadr, kind, items = 0;
+    int16_t c, t_min, t_max;
+    int     n_c, n_f, skipped = 0;
+
+    for (eeadr = 0; eeadr < EEADR_MENU + NO_OF_MENU_ITEMS; eeadr++)
+    {
+        kind = config_temp_type(eeadr);
+        if (kind == TEMP_NONE) continue;
+        items++;
+        fahrenheit = false;
+        n_c = walk(eeadr, 1);
+        if (walk(eeadr, -1) != n_c) FAIL("eeadr %d, C: UP and DOWN differ\n", eeadr);
+        t_min = check_config_value( 32767, eeadr); // rolls over to t_min
+        t_max = check_config_value(-32768, eeadr); // rolls over to t_max
+        for (c = t_min; c <= t_max; c++)
+        {   // switch to F and back
+            fahrenheit = true;
+            if (disp_to_temp(temp_to_disp(c, kind), kind) != c)
+                FAIL("eeadr %d: %d E-1 C changed by a switch to F\n", eeadr, c);
+            fahrenheit = false;
+        } // for
+        if ((eeadr >= EEADR_MENU) && (disp_to_temp(temp_to_disp(cfg_default[eeadr - EEADR_MENU], kind), kind) != cfg_default[eeadr - EEADR_MENU]))
+            FAIL("eeadr %d: default changed by a switch to F\n", eeadr);
+        fahrenheit = true;
+        n_f = walk(eeadr, 1);
+        if (walk(eeadr, -1) != n_f) FAIL("eeadr %d, F: UP and DOWN differ\n", eeadr);
+        if (n_f != n_c) FAIL("eeadr %d: %d values in F, %d in C\n", eeadr, n_f, n_c);
+        t_min = check_config_value(32767, eeadr);
+        t_max = check_config_value(-32768, eeadr);
+        skipped += (t_max - t_min + 1) - n_f;
+    } // for
+    if (!items) FAIL("no temperature parameters\n");
+
+#if !(defined(OVBSC))
+    // 68.0 F = 20.0 C, 68.1 F can not be stored, 68.2 F = 20.1 C
+    eeadr = EEADR_PROFILE_SETPOINT(0, 0);
+    fahrenheit = true;
+    if (disp_to_temp(681, TEMP_ABS) != 201) FAIL("68.1 F is not stored as 20.1 C\n");
+    if (step_config_value(680,  1, eeadr) != 682) FAIL("UP from 68.0 F does not skip 68.1 F\n");
+    if (step_config_value(682, -1, eeadr) != 680) FAIL("DOWN from 68.2 F does not skip 68.1 F\n");
+#endif
+    fahrenheit = false;
+    printf("menu: %d temperature parameters, %d F values skipped\n", items, skipped);
+} // menu_test()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : main() runs the tests.
+  Variables: -
+  Returns  : 0 = all passed
+  ---------------------------------------------------------------------------*/
+int main(void)
+{
+    table_test();
+    menu_test();
+    printf("%d failures\n", fails);
+    return fails ? 1 : 0;
+} // main()
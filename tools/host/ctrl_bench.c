@@ -0,0 +1,139 @@
+/*==================================================================
+  File Name    : ctrl_bench.c
+  ------------------------------------------------------------------
+  Purpose : Host benchmark of ctrl_task() with the RAM copy cfg of the
+            menu-items (src/eep.c), on the EEPROM model of eep_model.h.
+            For every run mode it reports:
+            - the accesses to cfg per call. Before the RAM copy, every
+              one of them was an eeprom_read_config() of the EEPROM;
+            - the EEPROM programming cycles per call, which must be 0
+              while nothing changes, and the cycles of the one
+              config_flush() after a menu-item is changed;
+            - the host time per call.
+            It also reports the RAM of cfg and its dirty bitmap
+            cfg_dirty[] against the 1 KB RAM of the STM8S103.
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdio.h>
+#include <time.h>
+#include "stm8as.h"
+#include "eep_model.h"
+
+config_t *cfg_access(void);
+
+#undef  ASM
+#define ASM(mnem)            // no STM8 instructions on the host
+#define main stc1000p_main   // main() of the firmware is not used
+#define cfg  (*cfg_access()) // count every access of the control code to cfg
+
+#include "stc1000p.c"
+#undef  main
+#include "stc1000p_lib.c"
+#include "scheduler.c"
+#include "temp.c"
+#include "pid.c"
+#if defined(OVBSC)
+#include "ovbsc.c"
+#endif
+#undef  cfg
+
+#define CALLS    (1000)    // ctrl_task() calls for the counts
+#define CALLS_T  (1000000) // ctrl_task() calls for the host time
+
+long cfg_accesses = 0;
+int  fails = 0;
+
+#define FAIL(...) do { if (fails++ < 10) printf(__VA_ARGS__); } while (0)
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function counts an access to cfg.
+  Variables: -
+  Returns  : the RAM copy of the menu-items
+  ---------------------------------------------------------------------------*/
+config_t *cfg_access(void)
+{
+    cfg_accesses++;
+    return &cfg;
+} // cfg_access()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function runs ctrl_task() in a run mode.
+  Variables: name: name of the run mode
+             ts  : the sample time of the PID controller, 0 = thermostat
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void bench(const char *name, int16_t ts)
+{
+    long    i, accesses, progs, flush;
+    clock_t t;
+
+    cfg.Ts = ts;
+#if !(defined(OVBSC))
+    cfg.rn = THERMOSTAT_MODE;
+#endif
+    memset(cfg_dirty, 0, sizeof(cfg_dirty));
+    ctrl_task(); // first call after a change
+    ee_sync();
+
+    accesses = cfg_accesses;
+    progs    = ee_progs;
+    for (i = 0; i < CALLS; i++) ctrl_task();
+    ee_sync();
+    accesses = cfg_accesses - accesses;
+    progs    = ee_progs - progs;
+    if (progs) FAIL("%s: %ld EEPROM cycles without a change\n", name, progs);
+
+    flush = ee_progs;
+    eeprom_write_config(EEADR_MENU_ITEM(tc), cfg.tc + 1); // changed in the menu
+    for (i = 0; i < CALLS; i++)
+    {
+        ctrl_task();
+        ee_sync();
+    } // for
+    flush = ee_progs - flush;
+    if (!flush) FAIL("%s: a changed menu-item is not written\n", name);
+
+    t = clock();
+    for (i = 0; i < CALLS_T; i++) ctrl_task();
+    t = clock() - t;
+    printf("%-10s: %.1f cfg accesses, %.3f EEPROM cycles per call, %ld for a change, %.3f usec. per call (host)\n",
+           name, (double)accesses / CALLS, (double)progs / CALLS, flush, 1e6 * t / CLOCKS_PER_SEC / CALLS_T);
+} // bench()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : main() loads the default configuration into the EEPROM model,
+             runs the benchmark and prints the RAM report. RAM_SIZE is the
+             RAM of the STM8S103, see stm8as.h.
+  Variables: -
+  Returns  : 0 = all passed
+  ---------------------------------------------------------------------------*/
+int main(void)
+{
+    int ram = sizeof(cfg) + sizeof(cfg_dirty);
+
+    memset(ee_mem, 0xff, EE_SIZE); // erased: default values
+    config_load();
+    ee_sync();
+    menu_is_idle = true;
+    temp_ntc1    = temp_ntc2 = 200;
+    bench("thermostat", 0);
+    bench("PID", 5);
+    printf("RAM: cfg %d bytes (%d menu-items) + cfg_dirty[] %d bytes = %d bytes, %.1f %% of %d bytes\n",
+           (int)sizeof(cfg), NO_OF_MENU_ITEMS, (int)sizeof(cfg_dirty), ram, 100.0 * ram / RAM_SIZE, RAM_SIZE);
+    if (sizeof(cfg) != 2 * NO_OF_MENU_ITEMS) FAIL("cfg is not 1 word per menu-item\n");
+    printf("%d failures\n", fails);
+    return fails ? 1 : 0;
+} // main()
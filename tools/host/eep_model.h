@@ -0,0 +1,132 @@
+/*==================================================================
+  File Name    : eep_model.h
+  ------------------------------------------------------------------
+  Purpose : Host model of the STM8 data EEPROM for the tests in this
+            directory. It includes src/eep.c with:
+            - EEP_BASE_ADDR pointing to ee_mem[] instead of 0x4000;
+            - every access to the FLASH registers goes through
+              ee_flash(), which ends a programming cycle after
+              ee_prog_polls reads (EOP) and unlocks the EEPROM at once.
+            Every programmed 4-byte block is counted in ee_cycles[] and,
+            with ee_log_on, recorded in ee_log[], so that a test can
+            replay the programming up to any byte and cut the power there.
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#ifndef EEP_MODEL_H
+#define EEP_MODEL_H
+
+#include <stdio.h>
+#include <string.h>
+#include "eep.h"
+
+#define EE_SIZE   (640)   // bytes of data EEPROM, STM8S103
+#define EE_BLOCKS (EE_SIZE / 4)
+#define EE_LOG    (16384) // max. number of recorded blocks
+
+typedef struct
+{
+    uint8_t Blk;     // block number
+    uint8_t Data[4]; // programmed contents
+} ee_prog;
+
+uint8_t  ee_mem[EE_SIZE];        // contents of the EEPROM
+uint32_t ee_cycles[EE_BLOCKS];   // programming cycles per block
+uint32_t ee_progs;               // programming cycles of all blocks
+int      ee_prog_polls = 0;      // EOP reads before a programming cycle ends
+int      ee_log_on     = 0;      // 1 = record every programmed block
+ee_prog  ee_log[EE_LOG];
+int      ee_nlog;
+
+volatile FLASH_t *ee_flash(void);
+
+#undef  EEP_BASE_ADDR
+#define EEP_BASE_ADDR (ee_mem)
+#define FLASH         (*ee_flash())
+
+#include "eep.c"
+
+#undef  FLASH
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function models the FLASH registers for eep.c. The block
+             that eeprom_poll() started to program is counted (and recorded)
+             at the first access after it, EOP is set ee_prog_polls
+             accesses later. The EEPROM is always unlocked.
+  Variables: -
+  Returns  : the FLASH registers
+  ---------------------------------------------------------------------------*/
+volatile FLASH_t *ee_flash(void)
+{
+    static int reads = -1; // accesses since the programming cycle started
+
+    if (!eep_busy) reads = -1;
+    else if (reads >= 0) reads++;
+    else
+    {   // new programming cycle of the oldest block in the write-queue
+        reads = 0;
+        ee_cycles[eep_q[eep_q_head].Blk]++;
+        ee_progs++;
+        if (ee_log_on && (ee_nlog < EE_LOG))
+        {
+            ee_log[ee_nlog].Blk = eep_q[eep_q_head].Blk;
+            memcpy(ee_log[ee_nlog].Data, eep_q[eep_q_head].Data, 4);
+            ee_nlog++;
+        } // if
+    } // else
+    FLASH.IAPSR.reg.EOP = eep_busy && (reads >= ee_prog_polls);
+    FLASH.IAPSR.reg.DUL = 1;
+    return &FLASH;
+} // ee_flash()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function programs all queued blocks and transactions.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void ee_sync(void)
+{
+    do eeprom_poll(); while (eep_q_cnt || (eep_jstate != EEP_J_IDLE)); // see eeprom_poll()
+} // ee_sync()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function models a power-down after the first n recorded
+             blocks of ee_log[] and t bytes of the next one, starting from
+             the EEPROM contents in mem. The RAM of eep.c is cleared.
+  Variables: mem: EEPROM contents before the first recorded block
+             n  : number of completely programmed blocks
+             t  : number of bytes (0..3) of block n that were programmed
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void ee_power_down(const uint8_t *mem, int n, int t)
+{
+    int i;
+
+    memcpy(ee_mem, mem, EE_SIZE);
+    for (i = 0; i < n; i++) memcpy(ee_mem + 4 * ee_log[i].Blk, ee_log[i].Data, 4);
+    if (n < ee_nlog) memcpy(ee_mem + 4 * ee_log[n].Blk, ee_log[n].Data, t);
+    eep_q_head = eep_q_cnt = 0;
+    eep_busy   = false;
+    eep_jn     = eep_ji = 0;
+    eep_jstate = EEP_J_IDLE;
+    eep_pn     = 0;
+#if !(defined(OVBSC))
+    ring_pending = false;
+#endif
+    memset(&cfg, 0, sizeof(cfg));
+    memset(cfg_dirty, 0, sizeof(cfg_dirty));
+} // ee_power_down()
+
+#endif
@@ -0,0 +1,761 @@
+/*==================================================================
+  File Name    : eep_test.c
+  ------------------------------------------------------------------
+  Purpose : Host tests of src/eep.c with the EEPROM model of
+            eep_model.h, built and run by 'make' in this directory:
+            - power-loss: every transaction (config_flush(), a profile
+              edit, eeprom_begin()..eeprom_commit()) is interrupted after
+              every programmed byte. After config_load() the words of a
+              transaction are all old or all new and the header is valid.
+            - migration: config_load() of a layout 20 image and of a
+              corrupted image is interrupted after every programmed byte,
+              also while it is done again. The next config_load() ends
+              with the same EEPROM and cfg as an uninterrupted one.
+            - non-blocking: config_flush() and a profile edit do not wait
+              for the EEPROM, also not while the previous transaction is
+              being written: up to EEP_PEND_SIZE profile values wait in
+              RAM, the next one is refused. The blocks that the former
+              eeprom_write_config() (git 19c3d05) waited for are printed.
+            - write-queue: eeprom_write() merges a value into the newest
+              block of the write-queue unless it is being programmed,
+              blocks are programmed in order, one programming cycle per
+              block and only after EOP; eeprom_queue() does not add to a
+              full write-queue, eeprom_write() waits.
+            - bit-flip: every bit of the configuration area and the header
+              is flipped, one at a time. config_load() must use the
+              default values (or only repair a flipped magic).
+            - ring (not OVBSC): RING_RECORDS records, the sequence number
+              wraps many times. After every record the newest one must be
+              found at power-up and every block of the ring must be
+              programmed equally often. Then every record of two more
+              sequence number wraps is interrupted after every programmed
+              byte: the old or the new record must be found. The EEPROM
+              lifetime with a record every minute is printed, with SP and
+              dh in place (before the ring) and with the ring. A reset to 
+              the default values, also when interrupted, must keep the
+              newest record.
+            - image (not OVBSC): config_load() uses build/eeprom.ihx of
+              tools/eeprom_image.py as it is, without a programming
+              cycle, with the default values and its example profiles.
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include "eep_model.h"
+
+#if defined(OVBSC)
+    #define TEMP_ITEM Pt1   // menu-item with an absolute temperature
+#else
+    #define TEMP_ITEM SP
+#endif
+
+#define EEPROM_IHX "../../build/eeprom.ihx" // relative to this directory, as SRC in the Makefile
+
+bool fahrenheit; // see config_migrate()
+int  fails = 0;
+int  cases = 0;
+
+uint8_t  mem0[EE_SIZE];   // EEPROM before a test
+uint8_t  mem1[EE_SIZE];   // EEPROM after an uninterrupted test
+config_t cfg1;            // cfg after an uninterrupted test
+
+#define FAIL(...) do { if (fails++ < 10) printf(__VA_ARGS__); } while (0)
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Stubs for stc1000p_lib.c: a conversion of degrees F into
+             degrees C in E-1 for TEMP_ITEM and the profile setpoints.
+  ---------------------------------------------------------------------------*/
+int16_t disp_to_temp(int16_t value, uint8_t kind)
+{
+    if (!fahrenheit || (kind != TEMP_ABS)) return value;
+    return (int16_t)(((value - 320) * 5) / 9);
+} // disp_to_temp()
+
+uint8_t config_temp_type(uint8_t eeadr)
+{
+    return (eeadr == EEADR_MENU + TEMP_ITEM) ? TEMP_ABS : TEMP_NONE;
+} // config_temp_type()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Helpers: a word of an EEPROM image, dirty menu-items and a
+             complete power-up.
+  ---------------------------------------------------------------------------*/
+uint16_t word(const uint8_t *mem, uint8_t adr)
+{
+    return (mem[adr << 1] << 8) | mem[(adr << 1) + 1];
+} // word()
+
+void set_word(uint8_t *mem, uint8_t adr, uint16_t w)
+{
+    mem[adr << 1]       = w >> 8;
+    mem[(adr << 1) + 1] = w & 0xff;
+} // set_word()
+
+bool dirty(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < CFG_DIRTY_BYTES; i++) if (cfg_dirty[i]) return true;
+    return false;
+} // dirty()
+
+void power_up(void)
+{
+    config_load();
+    ee_sync();
+} // power_up()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function checks the EEPROM after a power-up: valid header,
+             no committed transaction and no rewrite left.
+  Variables: -
+  Returns  : true = valid
+  ---------------------------------------------------------------------------*/
+bool valid(void)
+{
+    return (word(ee_mem, EEADR_HEADER)     == EEP_MAGIC)  &&
+           (word(ee_mem, EEADR_HEADER + 1) == EEP_LAYOUT) &&
+           (word(ee_mem, EEADR_HEADER + 2) == eeprom_crc(0, EEADR_CFG_END)) &&
+           !word(ee_mem, EEADR_JOURNAL) && !word(ee_mem, EEADR_MARKER) &&
+           !word(ee_mem, EEADR_MARKER + 1);
+} // valid()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function runs op on the EEPROM image mem0 and records all
+             programmed blocks. Then it cuts the power after every byte of
+             them and powers up again. The configuration area must be valid
+             and, if atomic, contain only old or only new values.
+  Variables: name  : name of the test
+             op    : the writes to test
+             atomic: true = op is a single transaction
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void power_loss(const char *name, void (*op)(void), bool atomic)
+{
+    int     n, t, adr, n_old, n_new;
+    int16_t temp0, temp1;
+
+    ee_power_down(mem0, 0, 0);
+    power_up();
+    temp0 = CFG_ITEM(TEMP_ITEM);
+    ee_nlog = 0; ee_log_on = 1;
+    op();
+    ee_sync();
+    ee_log_on = 0;
+    memcpy(mem1, ee_mem, EE_SIZE);
+    ee_power_down(mem1, 0, 0); // value after an uninterrupted op()
+    power_up();
+    temp1 = CFG_ITEM(TEMP_ITEM);
+    for (n = 0; n <= ee_nlog; n++)
+    {
+        for (t = 0; t < ((n < ee_nlog) ? 4 : 1); t++)
+        {
+            ee_power_down(mem0, n, t);
+            power_up();
+            cases++;
+            n_old = n_new = 0;
+            for (adr = 0; adr < EEADR_CFG_END; adr++)
+            {
+                if (word(mem0, adr) == word(mem1, adr)) continue;
+                if      (word(ee_mem, adr) == word(mem0, adr)) n_old++;
+                else if (word(ee_mem, adr) == word(mem1, adr)) n_new++;
+                else FAIL("%s: power-down at %d.%d: word %d is neither old nor new\n", name, n, t, adr);
+            } // for
+            if (atomic && n_old && n_new)
+                FAIL("%s: power-down at %d.%d: %d old and %d new words\n", name, n, t, n_old, n_new);
+            if (!valid()) FAIL("%s: power-down at %d.%d: header not valid\n", name, n, t);
+            if ((CFG_ITEM(TEMP_ITEM) != temp0) && (CFG_ITEM(TEMP_ITEM) != temp1))
+                FAIL("%s: power-down at %d.%d: menu-item %d is %d\n", name, n, t, TEMP_ITEM, CFG_ITEM(TEMP_ITEM));
+        } // for
+    } // for
+    printf("power-loss %-11s: %3d blocks programmed\n", name, ee_nlog);
+} // power_loss()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function runs config_load() on the EEPROM image mem0 and
+             cuts the power after every programmed byte; after every 5th
+             block also during the second config_load(). The next
+             config_load() must end like an uninterrupted one.
+  Variables: name: name of the test
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void power_loss_load(const char *name)
+{
+    static ee_prog log1[EE_LOG];
+    static uint8_t mem2[EE_SIZE];
+    int n, t, n2, t2, nlog1;
+
+    ee_power_down(mem0, 0, 0);
+    ee_nlog = 0; ee_log_on = 1;
+    power_up();
+    ee_log_on = 0;
+    memcpy(mem1, ee_mem, EE_SIZE);
+    cfg1  = cfg;
+    nlog1 = ee_nlog;
+    memcpy(log1, ee_log, sizeof(log1));
+    for (n = 0; n <= nlog1; n++)
+    {
+        for (t = 0; t < ((n < nlog1) ? 4 : 1); t++)
+        {
+            memcpy(ee_log, log1, sizeof(log1));
+            ee_nlog = nlog1;
+            ee_power_down(mem0, n, t);
+            memcpy(mem2, ee_mem, EE_SIZE);
+            ee_nlog = 0; ee_log_on = (n % 5 == 0);
+            power_up();
+            ee_log_on = 0;
+            cases++;
+            if (memcmp(ee_mem, mem1, EE_SIZE) || memcmp(&cfg, &cfg1, sizeof(cfg)))
+                FAIL("%s: power-down at %d.%d: not the same as without power-down\n", name, n, t);
+            for (n2 = 0; (n % 5 == 0) && (n2 <= ee_nlog); n2++)
+            {
+                for (t2 = 0; t2 < ((n2 < ee_nlog) ? 4 : 1); t2++)
+                {
+                    ee_power_down(mem2, n2, t2);
+                    power_up();
+                    cases++;
+                    if (memcmp(ee_mem, mem1, EE_SIZE) || memcmp(&cfg, &cfg1, sizeof(cfg)))
+                        FAIL("%s: power-down at %d.%d and %d.%d: not the same as without power-down\n",
+                             name, n, t, n2, t2);
+                } // for
+            } // for
+        } // for
+    } // for
+    printf("power-loss %-11s: %3d blocks programmed\n", name, nlog1);
+} // power_loss_load()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : The writes for power_loss().
+  ---------------------------------------------------------------------------*/
+void op_flush(void)
+{   // a few menu-items and a ring item
+    uint8_t i;
+
+    for (i = 0; i < 6; i++) eeprom_write_config(EEADR_MENU + 3 + i, 7 + i);
+    eeprom_write_config(EEADR_MENU + TEMP_ITEM, 123);
+    config_flush();
+} // op_flush()
+
+void op_flush_all(void)
+{   // more menu-items than fit in one transaction
+    uint8_t i;
+
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++)
+        eeprom_write_config(EEADR_MENU + i, (uint16_t)CFG_ITEM(i) + 1);
+    while (dirty())
+    {
+        config_flush();
+        ee_sync();
+    } // while
+} // op_flush_all()
+
+#if !(defined(OVBSC))
+void op_profile(void)
+{
+    eeprom_write_config(EEADR_PROFILE_SETPOINT(1, 2), 4321);
+} // op_profile()
+#endif
+
+void op_begin_commit(void)
+{   // a transaction of the maximum size
+    uint8_t i;
+
+    eeprom_begin();
+    for (i = 0; i < EEP_JOURNAL_SIZE - 3; i++) eeprom_write(i, 5000 + i);
+    config_header();
+    eeprom_commit();
+} // op_begin_commit()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function checks that config_flush() and a profile edit
+             only add to the write-queue and do not wait for the EEPROM,
+             also when the previous transaction is still being written.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void non_blocking(void)
+{
+    uint32_t progs;
+#if !(defined(OVBSC))
+    uint32_t waited;
+#endif
+    uint8_t  i;
+
+    ee_power_down(mem0, 0, 0);
+    power_up();
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++)
+        eeprom_write_config(EEADR_MENU + i, (uint16_t)CFG_ITEM(i) + 2);
+    cfg1  = cfg;
+    progs = ee_progs;
+    config_flush();
+    eeprom_poll();
+    config_flush(); // previous transaction not written yet: returns at once
+#if !(defined(OVBSC))
+    eeprom_write_config(EEADR_POWER_ON, 0); // ring record
+#endif
+    if (ee_progs - progs > 1) FAIL("config_flush() waited for %u blocks\n", ee_progs - progs);
+    if (eep_q_cnt > EEP_QUEUE_SIZE) FAIL("write-queue overflow\n");
+    ee_sync();
+#if !(defined(OVBSC))
+    progs = ee_progs;
+    eeprom_write_config(EEADR_PROFILE_SETPOINT(0, 0), 777);
+    if (ee_progs != progs) FAIL("profile edit waited for %u blocks\n", ee_progs - progs);
+    ee_sync();
+    // profile edits while the largest config_flush() is being written
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++)
+        if (!RING_ITEM(i)) eeprom_write_config(EEADR_MENU + i, (uint16_t)CFG_ITEM(i) + 1);
+    config_flush();
+    eeprom_poll();
+    cfg1  = cfg;
+    progs = ee_progs;
+    for (i = 0; i < EEP_PEND_SIZE; i++)
+        if (!eeprom_write_config(EEADR_PROFILE_SETPOINT(1, i), 600 + i)) FAIL("profile edit %d refused\n", i);
+    if (ee_progs != progs) FAIL("profile edit during a flush waited for %u blocks\n", ee_progs - progs);
+    if (eeprom_write_config(EEADR_PROFILE_SETPOINT(2, 0), 700)) FAIL("profile edit not refused\n");
+    for (i = 0; i < EEP_PEND_SIZE; i++)
+        if (eeprom_read_config(EEADR_PROFILE_SETPOINT(1, i)) != 600 + i) FAIL("profile edit %d not read back\n", i);
+    while (eep_jstate != EEP_J_IDLE) eeprom_poll();
+    waited = ee_progs - progs; // former eeprom_write_config(): while (!eeprom_begin()) eeprom_poll();
+    ee_sync();
+    while (dirty())
+    {
+        config_flush();
+        ee_sync();
+    } // while
+    ee_power_down(ee_mem, 0, 0);
+    power_up();
+    if (!valid()) FAIL("profile edits during a flush: header not valid\n");
+    for (i = 0; i < EEP_PEND_SIZE; i++)
+        if (eeprom_read_config(EEADR_PROFILE_SETPOINT(1, i)) != 600 + i) FAIL("profile edit %d not written\n", i);
+    if (memcmp(&cfg, &cfg1, sizeof(cfg))) FAIL("profile edits during a flush: menu-items not written\n");
+    printf("profile edit          :   0 blocks waited during a flush, %u before (git 19c3d05)\n", waited);
+#endif
+    while (dirty())
+    {
+        config_flush();
+        ee_sync();
+    } // while
+    ee_power_down(ee_mem, 0, 0); // RAM cleared, EEPROM kept
+    power_up();
+    if (memcmp(&cfg, &cfg1, sizeof(cfg))) FAIL("non-blocking: menu-items not written\n");
+    printf("non-blocking          : %3u blocks programmed\n", ee_progs - progs);
+} // non_blocking()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function makes mem0 an image with the current layout, of
+             which every profile word and menu-item differs from the default.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void make_current_image(void)
+{
+    uint8_t i;
+
+    memset(mem0, 0, EE_SIZE);
+    ee_power_down(mem0, 0, 0);
+    power_up(); // default values
+    for (i = 0; i < EEADR_MENU; i++)
+        while (!eeprom_write_config(i, 100 + i)) eeprom_poll(); // profile values waiting
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++)
+        eeprom_write_config(EEADR_MENU + i, (uint16_t)CFG_ITEM(i) + 1);
+    while (dirty())
+    {
+        config_flush();
+        ee_sync();
+    } // while
+    memcpy(mem0, ee_mem, EE_SIZE);
+} // make_current_image()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function checks the write-queue of eeprom_write() and
+             eeprom_poll(), with a programming cycle of ee_prog_polls
+             accesses to the FLASH registers. Words 200 and up (the
+             scratch area) are used.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void write_queue(void)
+{
+    static const uint8_t order[] = { 100, 101, 100 };
+    uint32_t progs;
+    uint8_t  i;
+    int      polls;
+
+    ee_power_down(mem0, 0, 0);
+    ee_prog_polls = 3;
+    ee_nlog = 0; ee_log_on = 1;
+    progs = ee_progs;
+
+    // values in the same block are merged into the newest entry
+    eeprom_write(200, 0x1111);
+    eeprom_write(201, 0x2222);
+    eeprom_write(200, 0x3333);
+    if (eep_q_cnt != 1) FAIL("write-queue: %d entries instead of 1\n", eep_q_cnt);
+    eeprom_write(201, 0x2222); // same value: nothing to do
+    if (eep_q_cnt != 1) FAIL("write-queue: same value added\n");
+
+    // a block that is being programmed is not changed
+    eeprom_poll();
+    if (!eep_busy) FAIL("write-queue: programming not started\n");
+    eeprom_write(201, 0x4444);
+    if (eep_q_cnt != 2) FAIL("write-queue: block being programmed changed\n");
+    if ((eeprom_read(200) != 0x3333) || (eeprom_read(201) != 0x4444))
+        FAIL("write-queue: values in the write-queue not read\n");
+
+    // the next block is programmed after EOP only
+    for (polls = 1; eep_q_cnt == 2; polls++)
+    {
+        eeprom_poll();
+        if (polls > 100) break;
+    } // for
+    if (polls <= ee_prog_polls) FAIL("write-queue: next block after %d polls\n", polls);
+
+    // a block that is not the newest entry gets a new entry
+    eeprom_write(202, 0x5555);
+    eeprom_write(200, 0x6666);
+    ee_sync();
+    for (i = 0; i < 3; i++)
+        if ((i + 1 >= ee_nlog) || (ee_log[i + 1].Blk != order[i]))
+            FAIL("write-queue: block %d not programmed in order\n", i);
+    if ((word(ee_mem, 200) != 0x6666) || (word(ee_mem, 201) != 0x4444) || (word(ee_mem, 202) != 0x5555))
+        FAIL("write-queue: wrong values programmed\n");
+
+    // a full write-queue refuses a block, eeprom_write() waits, blocks stay in order
+    ee_nlog = 0;
+    for (i = 0; i < EEP_QUEUE_SIZE + 4; i++)
+    {
+        eeprom_write(204 + 2 * i, 0x7000 + i);
+        if (eep_q_cnt > EEP_QUEUE_SIZE) FAIL("write-queue: overflow\n");
+        if ((eep_q_cnt == EEP_QUEUE_SIZE) && eeprom_queue(250, 0x1234)) FAIL("write-queue: full, value queued\n");
+    } // for
+    ee_sync();
+    for (i = 0; i < EEP_QUEUE_SIZE + 4; i++)
+    {
+        if ((i >= ee_nlog) || (ee_log[i].Blk != 102 + i)) FAIL("write-queue: full, block %d not in order\n", i);
+        if (word(ee_mem, 204 + 2 * i) != 0x7000 + i) FAIL("write-queue: full, block %d not programmed\n", i);
+    } // for
+    if (ee_progs - progs != 4 + EEP_QUEUE_SIZE + 4) 
+        FAIL("write-queue: %u programming cycles\n", ee_progs - progs);
+    ee_log_on = 0;
+    ee_prog_polls = 0;
+    printf("write-queue           : %3u blocks programmed\n", ee_progs - progs);
+} // write_queue()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function flips every bit of the configuration area and the
+             header of the image mem0, one at a time, and checks that
+             config_load() falls back to the default values, except for the
+             runtime state in the ring (not OVBSC). A flipped magic is 
+             repaired, the menu-items are kept.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void bit_flip(void)
+{
+    static uint8_t mem2[EE_SIZE];
+    config_t def;
+    uint8_t  adr, bit, i;
+    bool     magic;
+
+    ee_power_down(mem0, 0, 0);
+    power_up();
+    cfg1 = cfg;
+    memcpy(&def, cfg_default, sizeof(def));
+#if !(defined(OVBSC))
+    def.SP = cfg1.SP; def.dh = cfg1.dh; def.St = cfg1.St; def.rn = cfg1.rn; // kept in the ring
+#endif
+    for (adr = 0; adr < EEADR_HEADER + 3; adr++)
+    {
+        if ((adr >= EEADR_CFG_END) && (adr < EEADR_HEADER)) continue;
+        magic = (adr == EEADR_HEADER);
+        for (bit = 0; bit < 16; bit++)
+        {
+            memcpy(mem2, mem0, EE_SIZE);
+            set_word(mem2, adr, word(mem0, adr) ^ (1 << bit));
+            ee_power_down(mem2, 0, 0);
+            power_up();
+            cases++;
+            if (!valid()) FAIL("bit-flip: word %d, bit %d: header not valid\n", adr, bit);
+            if (memcmp(&cfg, magic ? &cfg1 : &def, sizeof(cfg)))
+                FAIL("bit-flip: word %d, bit %d: menu-items not %s\n", adr, bit, magic ? "kept" : "default");
+            for (i = 0; !magic && (i < EEADR_MENU); i++)
+                if (word(ee_mem, i)) FAIL("bit-flip: word %d, bit %d: profiles not cleared\n", adr, bit);
+        } // for
+    } // for
+    printf("bit-flip              : %3d words\n", EEADR_CFG_END + 3);
+} // bit_flip()
+
+#if !(defined(OVBSC))
+#define RING_RECORDS (RING_SLOTS * 320) // sequence number wraps 40 times
+#define EE_ENDURANCE (300000.0)         // programming cycles, STM8S103 data EEPROM
+#define RING_RATE    (60.0 * 24 * 365)  // records per year: a profile step every minute
+
+typedef struct
+{
+    int16_t SP, dh;
+    int16_t St, rn;
+    bool    pwr;
+} ring_state; // runtime state in a ring record
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Helpers: the runtime state in cfg and a new ring record.
+  ---------------------------------------------------------------------------*/
+ring_state ring_get(void)
+{
+    ring_state s;
+
+    memset(&s, 0, sizeof(s));
+    s.SP  = cfg.SP;
+    s.dh  = cfg.dh;
+    s.St  = cfg.St;
+    s.rn  = cfg.rn;
+    s.pwr = cfg_pwr_on;
+    return s;
+} // ring_get()
+
+bool ring_same(ring_state a, ring_state b)
+{
+    return !memcmp(&a, &b, sizeof(a));
+} // ring_same()
+
+void ring_record(uint32_t k)
+{   // every word of the record changes
+    eeprom_write_config(EEADR_MENU + SP, 100 + k % 900);
+    eeprom_write_config(EEADR_MENU + dh, k % 1000);
+    eeprom_write_config(EEADR_MENU + St, k % 9);
+    eeprom_write_config(EEADR_MENU + rn, k % NO_OF_PROFILES);
+    cfg_pwr_on = (k >> 1) & 0x01;
+    config_flush();
+    ee_sync();
+} // ring_record()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function writes many records to the ring of the image
+             mem0 and checks the newest record after a power-up, the
+             programming cycles per block and interrupted records.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void ring_endurance(void)
+{
+    static uint8_t mem2[EE_SIZE], mem3[EE_SIZE];
+    ring_state prev, now;
+    uint32_t   k, cyc_min = 0xffffffffUL, cyc_max = 0;
+    uint8_t    b, b_ring = EEADR_RING >> 1, b_end = (EEADR_RING + RING_SLOTS * RING_REC_SIZE) >> 1;
+    int        n, t, torn = 0;
+
+    ee_power_down(mem0, 0, 0);
+    power_up();
+    memset(ee_cycles, 0, sizeof(ee_cycles));
+    for (k = 0; k < RING_RECORDS; k++)
+    {
+        ring_record(k);
+        now = ring_get();
+        memcpy(mem2, ee_mem, EE_SIZE);
+        ee_power_down(mem2, 0, 0);
+        power_up();
+        cases++;
+        if (!ring_same(ring_get(), now)) FAIL("ring: record %u not found at power-up\n", k);
+    } // for
+    for (b = 0; b < EE_BLOCKS; b++)
+    {
+        if ((b < b_ring) || (b >= b_end))
+        {
+            if (ee_cycles[b]) FAIL("ring: block %d outside the ring programmed\n", b);
+            continue;
+        } // if
+        if (ee_cycles[b] < cyc_min) cyc_min = ee_cycles[b];
+        if (ee_cycles[b] > cyc_max) cyc_max = ee_cycles[b];
+    } // for
+    if ((cyc_max > RING_RECORDS / RING_SLOTS + 1) || (cyc_max - cyc_min > 1))
+        FAIL("ring: %u..%u programming cycles per block\n", cyc_min, cyc_max);
+    printf("ring endurance        : %u records, %u..%u cycles per block\n", RING_RECORDS, cyc_min, cyc_max);
+
+    for (k = RING_RECORDS; k < RING_RECORDS + 2 * 256; k++)
+    {
+        prev = ring_get();
+        memcpy(mem2, ee_mem, EE_SIZE);
+        ee_nlog = 0; ee_log_on = 1;
+        ring_record(k);
+        ee_log_on = 0;
+        now = ring_get();
+        memcpy(mem3, ee_mem, EE_SIZE);
+        for (n = 0; n <= ee_nlog; n++)
+        {
+            for (t = 0; t < ((n < ee_nlog) ? 4 : 1); t++)
+            {
+                ee_power_down(mem2, n, t);
+                power_up();
+                cases++; torn++;
+                if (!ring_same(ring_get(), prev) && !ring_same(ring_get(), now))
+                    FAIL("ring: record %u, power-down at %d.%d: neither old nor new\n", k, n, t);
+                if (!valid()) FAIL("ring: record %u, power-down at %d.%d: header not valid\n", k, n, t);
+            } // for
+        } // for
+        if (k % 3) ee_power_down(mem3, 0, 0);
+        else
+        {   // go on after a record that was interrupted in its last block
+            ee_power_down(mem2, 1, 2);
+            now = prev;
+        } // else
+        power_up();
+        if (!ring_same(ring_get(), now)) FAIL("ring: record %u: wrong record at power-up\n", k);
+    } // for
+    printf("ring torn records     : %d power-downs\n", torn);
+
+    // Lifetime before the ring: SP and dh programmed in place for every record
+    memset(ee_cycles, 0, sizeof(ee_cycles));
+    for (k = 0; k < RING_SLOTS; k++)
+    {
+        eeprom_write(EEADR_MENU + SP, 100 + k);
+        eeprom_write(EEADR_MENU + dh, k);
+        ee_sync();
+    } // for
+    for (b = 0, n = 0; b < EE_BLOCKS; b++) if (ee_cycles[b] > n) n = ee_cycles[b];
+    printf("ring lifetime         : %.0f records/year, %.0f cycles: in place %.2f years, ring %.1f years\n",
+           RING_RATE, EE_ENDURANCE, EE_ENDURANCE / (RING_RATE * n / RING_SLOTS),
+           EE_ENDURANCE / (RING_RATE * cyc_max / RING_RECORDS));
+} // ring_endurance()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function corrupts the configuration area of an image with
+             the newest ring record in a given slot. The reset to the default
+             values (config_mark() overwrites the ring) is interrupted after
+             every programmed byte: the runtime state must be kept.
+  Variables: slot: slot of the newest record
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void ring_rewrite(uint8_t slot)
+{
+    static char name[20];
+    ring_state  now;
+    config_t    def;
+    uint32_t    k = 0;
+
+    make_current_image();
+    ee_power_down(mem0, 0, 0);
+    power_up();
+    do ring_record(k++); while (ring_slot != slot);
+    now = ring_get();
+    memcpy(mem0, ee_mem, EE_SIZE);
+    set_word(mem0, EEADR_MENU + hy, word(mem0, EEADR_MENU + hy) ^ 0x0100); // wrong CRC
+    sprintf(name, "ring-slot-%d", slot);
+    power_loss_load(name);
+    cfg = cfg1;
+    memcpy(&def, cfg_default, sizeof(def));
+    def.SP = now.SP; def.dh = now.dh; def.St = now.St; def.rn = now.rn;
+    if (!ring_same(ring_get(), now) || memcmp(&cfg1, &def, sizeof(def)))
+        FAIL("%s: runtime state not kept\n", name);
+} // ring_rewrite()
+#endif
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function makes mem0 an image of layout 20 (no header) with
+             temperatures in degrees F.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void make_v20_image(void)
+{
+    uint8_t i, menu = EEP_LAYOUT_MENU(EEP_LEGACY_LAYOUT);
+
+    memset(mem0, 0, EE_SIZE);
+    for (i = 0; i < menu; i++) set_word(mem0, i, (i & 0x01) ? 10 + i : 600 + 10 * i);
+    for (i = 0; i < NO_OF_MENU_ITEMS; i++)
+        if (map_v20[i] != EEP_NONE) set_word(mem0, menu + map_v20[i], cfg_default[i]);
+    set_word(mem0, menu + map_v20[CF], 1);         // degrees F
+    set_word(mem0, menu + map_v20[TEMP_ITEM], 680); // 20.0 degrees C
+#if !(defined(OVBSC))
+    set_word(mem0, menu + V20_ITEMS, 1);           // power-on flag
+#endif
+} // make_v20_image()
+
+#if !(defined(OVBSC))
+/*-----------------------------------------------------------------------------
+  Purpose  : This function loads the Intel-hex records of EEPROM_IHX into 
+             the EEPROM model and powers up. config_load() must not program
+             the EEPROM and must keep the profiles of the image.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void image(void)
+{
+    FILE     *f = fopen(EEPROM_IHX, "r");
+    char      line[80];
+    unsigned  n, adr, type, b, i;
+    uint32_t  progs;
+
+    if (!f)
+    {
+        FAIL("image: %s not found\n", EEPROM_IHX);
+        return;
+    } // if
+    memset(ee_mem, 0, EE_SIZE);
+    while (fgets(line, sizeof(line), f) && (sscanf(line, ":%2x%4x%2x", &n, &adr, &type) == 3) && !type)
+        for (i = 0; i < n; i++)
+            if ((adr - 0x4000 + i < EE_SIZE) && (sscanf(line + 9 + 2 * i, "%2x", &b) == 1))
+                ee_mem[adr - 0x4000 + i] = b;
+    fclose(f);
+    progs = ee_progs;
+    power_up();
+    if (ee_progs != progs) FAIL("image: %u programming cycles at power-up\n", (unsigned)(ee_progs - progs));
+    if (!valid()) FAIL("image: not valid\n");
+    if (memcmp(&cfg, cfg_default, sizeof(cfg))) FAIL("image: not the default values\n");
+    if ((eeprom_read_config(EEADR_PROFILE_SETPOINT(0, 0)) != 110) || (eeprom_read_config(EEADR_PROFILE_DURATION(0, 0)) != 504))
+        FAIL("image: profiles not kept\n");
+} // image()
+#endif
+
+/*-----------------------------------------------------------------------------
+  Purpose  : main() runs all tests.
+  Variables: -
+  Returns  : 0 = all passed
+  ---------------------------------------------------------------------------*/
+int main(void)
+{
+    make_current_image();
+    power_loss("flush", op_flush, true);
+    power_loss("flush-all", op_flush_all, false);
+#if !(defined(OVBSC))
+    power_loss("profile", op_profile, true);
+#endif
+    power_loss("transaction", op_begin_commit, true);
+    non_blocking();
+    write_queue();
+    bit_flip();
+#if !(defined(OVBSC))
+    ring_endurance();
+#endif
+
+    make_v20_image();
+    power_loss_load("v20");
+    if ((cfg1.CF != 1) || (cfg1.TEMP_ITEM != 200)) FAIL("v20: not converted\n");
+#if !(defined(OVBSC))
+    if (word(mem1, 0) != 155) FAIL("v20: profile not converted\n");
+#endif
+    memset(mem0, 0x5a, EE_SIZE);
+    set_word(mem0, EEADR_HEADER    , EEP_MAGIC);
+    set_word(mem0, EEADR_HEADER + 1, EEP_LAYOUT);
+    memset(mem0 + 2 * EEADR_MARKER, 0, 4);
+    power_loss_load("corrupted");
+    if (memcmp(&cfg1, cfg_default, sizeof(cfg1))) FAIL("corrupted: not the default values\n");
+#if !(defined(OVBSC))
+    ring_rewrite(3);              // inside the copy of config_mark()
+    ring_rewrite(RING_SLOTS - 1); // in the slot that is kept
+    image();
+#endif
+
+    printf("%d power-downs, %d failures\n", cases, fails);
+    return fails ? 1 : 0;
+} // main()
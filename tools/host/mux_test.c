@@ -0,0 +1,171 @@
+/*==================================================================
+  File Name    : mux_test.c
+  ------------------------------------------------------------------
+  Purpose : Host simulation of the display multiplexer, the buttons and
+            the ADC on the shared GPIO pins of the STC1000P: the Timer 2
+            interrupt, multiplexer(), adc_task(), read_buttons(),
+            adc_start() and adc_isr() of src/ run on plain memory for the
+            port and ADC registers. After every msec. it checks that:
+            - at most one common-cathode is enabled;
+            - the display is off while the AD-channels are inputs;
+            - the buttons are read with the display off, the pins are
+              outputs again afterwards and the value is correct;
+            - the conversions start 1 msec. after the AD-channels became
+              inputs and both probes get their own conversion results;
+            - a blank slot is only added for a request, so the display is
+              on for almost all msecs.
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdio.h>
+#include "stm8as.h"
+
+#undef  ASM
+#define ASM(mnem)          // no STM8 instructions on the host
+#define main stc1000p_main // main() of the firmware is not used
+
+#include "stc1000p.c"
+#undef  main
+#include "stc1000p_lib.c"
+#include "scheduler.c"
+#include "eep.c"
+#include "temp.c"
+#include "pid.c"
+
+#define TICKS     (60000L) // 1 minute
+#define AD_VALUE1 (0x123)  // conversion result of NTC probe 1
+#define AD_VALUE2 (0x2ba)  // conversion result of NTC probe 2
+
+int fails = 0;
+
+#define FAIL(...) do { if (fails++ < 10) printf(__VA_ARGS__); } while (0)
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function returns the enabled common-cathodes (low).
+  Variables: -
+  Returns  : bit 3..0: 10s, 1s, 0.1s, extras
+  ---------------------------------------------------------------------------*/
+uint8_t digits_on(void)
+{
+    uint8_t d = 0;
+
+    if (!(PORT_B.ODR.byte & CC_10)) d |= 0x08;
+    if (!(PORT_B.ODR.byte & CC_1))  d |= 0x04;
+    if (!(PORT_D.ODR.byte & CC_01)) d |= 0x02;
+    if (!(PORT_D.ODR.byte & CC_e))  d |= 0x01;
+    return d;
+} // digits_on()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function models the ADC: every conversion gives the result
+             of the selected channel, until adc_isr() is done.
+  Variables: t: the current msec.
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void conversions(long t)
+{
+    uint16_t v;
+    int      n = 0;
+
+    while ((adc_state == ADC_BUSY) && (n++ < 1000))
+    {
+        v = (ADC1.CSR.reg.CH == AD_NTC1) ? AD_VALUE1 : AD_VALUE2;
+        ADC1.DR.byteH = v >> 8;
+        ADC1.DR.byteL = v & 0xff;
+        adc_isr();
+    } // while
+    if (n != ADC_CONV) FAIL("%ld: %d conversions instead of %d\n", t, n, ADC_CONV);
+    if ((adc_sum[0] != (adc_sum_t)ADC_AVG * AD_VALUE1) || (adc_sum[1] != (adc_sum_t)ADC_AVG * AD_VALUE2))
+        FAIL("%ld: conversion results of the probes mixed up\n", t);
+    if (((PORT_D.DDR.byte & AD_CHANNELS) != AD_CHANNELS) || ((PORT_D.CR1.byte & AD_CHANNELS) != AD_CHANNELS))
+        FAIL("%ld: AD-channels not outputs again\n", t);
+} // conversions()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : main() runs the Timer 2 interrupt for TICKS msec., with
+             read_buttons() every 100 msec. and adc_task() every 500 msec.
+             like the scheduler, and checks the ports after every msec.
+  Variables: -
+  Returns  : 0 = all passed
+  ---------------------------------------------------------------------------*/
+int main(void)
+{
+    long    t, t_keys = 0, t_adc = 0, t_input = 0, shown[4] = {0}, blank = 0;
+    long    lat_keys = 0, lat_adc = 0;
+    uint8_t keys_in = 0, d, i, state;
+    bool    req;
+
+    portd_leds = PORTD_LEDS;
+    setup_output_ports();
+    pwr_on = true;
+    PORT_C.IDR.byte = BUTTONS; // no buttons pressed
+    for (t = 1; t <= TICKS; t++)
+    {
+        if (t % 100 == 0)
+        {
+            read_buttons();
+            t_keys = t;
+        } // if
+        if ((t % 500 == 0) && (adc_state == ADC_IDLE))
+        {
+            adc_task();
+            t_adc = t;
+        } // if
+        if (t % 3000 == 0)
+        {   // press other buttons, 0 = pressed
+            keys_in = (t / 3000) & 0x0f;
+            PORT_C.IDR.byte = (~keys_in << 3) & BUTTONS;
+        } // if
+        req   = keys_req;
+        state = adc_state;
+        TIM2_UPD_ISR();
+        d = digits_on();
+        if (d & (d - 1)) FAIL("%ld: more than one digit on (0x%x)\n", t, d);
+        for (i = 0; i < 4; i++) if (d & (1 << i)) shown[i]++;
+        if (!d)
+        {
+            blank++;
+            if (!req && (state != ADC_REQUEST) && (state != ADC_SETTLE))
+                FAIL("%ld: blank slot without a request\n", t);
+        } // if
+        if (req && !keys_req)
+        {   // buttons read in this msec.
+            if (d) FAIL("%ld: buttons read with the display on\n", t);
+            if ((PORT_C.DDR.byte & BUTTONS) != BUTTONS) FAIL("%ld: buttons not outputs again\n", t);
+            if (keys != keys_in) FAIL("%ld: buttons 0x%x instead of 0x%x\n", t, keys, keys_in);
+            if (t - t_keys > lat_keys) lat_keys = t - t_keys;
+        } // if
+        if ((PORT_D.DDR.byte & AD_CHANNELS) != AD_CHANNELS)
+        {   // AD-channels are inputs
+            if (d) FAIL("%ld: display on while the AD-channels are inputs\n", t);
+            if (!t_input) t_input = t;
+        } // if
+        if (adc_state == ADC_BUSY)
+        {   // adc_start() in this msec.
+            if ((state != ADC_SETTLE) || !t_input || (t - t_input < 1))
+                FAIL("%ld: conversions started without settling\n", t);
+            if (t - t_adc > lat_adc) lat_adc = t - t_adc;
+            t_input = 0;
+            conversions(t);
+        } // if
+    } // for
+    for (i = 0; i < 4; i++)
+        if ((shown[i] < shown[0] - 1) || (shown[i] > shown[0] + 1))
+            FAIL("digit %d shown %ld times instead of %ld\n", i, shown[i], shown[0]);
+    printf("multiplexer: %ld msec., display on %.2f %%, buttons after %ld msec., conversions after %ld msec.\n",
+           TICKS, 100.0 * (TICKS - blank) / TICKS, lat_keys, lat_adc);
+    printf("%d failures\n", fails);
+    return fails ? 1 : 0;
+} // main()
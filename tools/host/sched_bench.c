@@ -0,0 +1,202 @@
+/*==================================================================
+  File Name    : sched_bench.c
+  ------------------------------------------------------------------
+  Purpose : Host benchmark of the delta-queue in src/scheduler.c against
+            the linear scan of all tasks in scheduler_isr() before it
+            (git 6183f56^), for 4, 8 and 16 tasks. The tasks of TASK_DATA
+            in stc1000p.h are replaced by a synthetic table of 16 tasks
+            with different periods, of which the first 4, 8 or 16 are
+            started. For every number of tasks it reports:
+            - the task entries touched by the interrupt per tick: the
+              linear scan touches every task, the delta-queue only the
+              first entry and the tasks released at that tick;
+            - the host time per tick of the interrupt plus dispatch,
+              only an indication for the STM8.
+            Both versions must release the same number of tasks.
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stc1000p.h"
+
+// Synthetic task table: ID, function, initial delay (msec.), period (msec.)
+// and WCET (usec.), as TASK_DATA in stc1000p.h
+#undef  TASK_DATA
+#undef  TIMER_DATA
+#define TASK_DATA(_) \
+    _(T0 , bench_task,  0,    10, 100) _(T1 , bench_task,  1,    20, 100) \
+    _(T2 , bench_task,  2,    25, 100) _(T3 , bench_task,  3,    50, 100) \
+    _(T4 , bench_task,  4,   100, 100) _(T5 , bench_task,  5,   125, 100) \
+    _(T6 , bench_task,  6,   200, 100) _(T7 , bench_task,  7,   250, 100) \
+    _(T8 , bench_task,  8,   500, 100) _(T9 , bench_task,  9,   750, 100) \
+    _(T10, bench_task, 10,  1000, 100) _(T11, bench_task, 11,  1500, 100) \
+    _(T12, bench_task, 12,  2000, 100) _(T13, bench_task, 13,  5000, 100) \
+    _(T14, bench_task, 14, 10000, 100) _(T15, bench_task, 15, 60000, 100)
+#define TIMER_DATA(_) // no timers
+
+void bench_task(void);
+
+#include "scheduler.h"
+
+#undef  DISABLE_INTERRUPTS
+#undef  ENABLE_INTERRUPTS
+#define DISABLE_INTERRUPTS
+#define ENABLE_INTERRUPTS
+
+#include "scheduler.c"
+
+#define BENCH (10000000L) // ticks per run
+
+int  fails = 0;
+long runs;               // task runs
+
+#define FAIL(...) do { if (fails++ < 10) printf(__VA_ARGS__); } while (0)
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Stubs of the synthetic task and of the event handlers of
+             stc1000p.h.
+  ---------------------------------------------------------------------------*/
+void bench_task(void) { runs++; }
+void disp_test_done(uint8_t data) { (void)data; }
+void adc_done(uint8_t data)       { (void)data; }
+
+/*-----------------------------------------------------------------------------
+  Purpose  : scheduler_isr() and dispatch_tasks() before the delta-queue
+             (git 6183f56^) for the first n tasks: every tick the Delay or
+             Counter of every task is decremented.
+  ---------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Period, Delay, Counter;
+    uint8_t  Status;
+} old_task;
+
+old_task old_list[NO_OF_TASKS];
+uint8_t  old_n;
+
+void old_init(uint8_t n)
+{
+    uint8_t i;
+
+    old_n = n;
+    for (i = 0; i < n; i++)
+    {
+        old_list[i].Period  = old_list[i].Counter = task_table[i].Period;
+        old_list[i].Delay   = task_table[i].Delay;
+        old_list[i].Status  = TASK_ENABLED;
+    } // for
+} // old_init()
+
+void old_isr(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < old_n; i++)
+    {
+        if (old_list[i].Delay > 0) old_list[i].Delay--;
+        else if (--old_list[i].Counter == 0) old_list[i].Status |= TASK_READY;
+    } // for
+} // old_isr()
+
+void old_dispatch(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < old_n; i++)
+    {
+        if ((old_list[i].Status & (TASK_READY | TASK_ENABLED)) == (TASK_READY | TASK_ENABLED))
+        {
+            task_table[i].pFunction();
+            old_list[i].Status  &= ~TASK_READY;
+            old_list[i].Counter  = old_list[i].Period;
+        } // if
+    } // for
+} // old_dispatch()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function starts the delta-queue with the first n tasks,
+             the other tasks are removed from it and disabled.
+  Variables: n: number of tasks
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void new_init(uint8_t n)
+{
+    uint8_t i;
+
+    memset(task_list, 0, sizeof(task_list));
+    q_head      = NO_TASK;
+    sched_ticks = 0;
+    init_tasks();
+    for (i = n; i < NO_OF_TASKS; i++)
+    {
+        dequeue_task(i);
+        task_list[i].Status = 0;
+    } // for
+} // new_init()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function runs both versions with the first n tasks.
+  Variables: n: number of tasks
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void bench(uint8_t n)
+{
+    clock_t c;
+    double  ns_new, ns_old;
+    long    t, runs_new, touched = 0;
+
+    new_init(n);
+    runs = 0;
+    c    = clock();
+    for (t = 0; t < BENCH; t++)
+    {
+        scheduler_isr();
+        if (sched_pending) dispatch_tasks();
+    } // for
+    ns_new   = (double)(clock() - c) * 1e9 / CLOCKS_PER_SEC / BENCH;
+    runs_new = runs;
+    touched  = BENCH + runs_new; // first entry every tick, plus every release
+
+    old_init(n);
+    runs = 0;
+    c    = clock();
+    for (t = 0; t < BENCH; t++)
+    {
+        old_isr();
+        old_dispatch();
+    } // for
+    ns_old = (double)(clock() - c) * 1e9 / CLOCKS_PER_SEC / BENCH;
+
+    if (runs != runs_new) FAIL("%d tasks: %ld task runs instead of %ld\n", n, runs_new, runs);
+    if (touched >= (long)n * BENCH) FAIL("%d tasks: delta-queue touches %ld entries, not less than the scan\n", n, touched);
+    printf("%2d tasks: entries per tick %.3f delta-queue, %d linear scan; %.1f ns/tick delta-queue, %.1f ns/tick linear scan (host)\n",
+           n, (double)touched / BENCH, n, ns_new, ns_old);
+} // bench()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : main() runs the benchmark for 4, 8 and 16 tasks.
+  Variables: -
+  Returns  : 0 = all passed
+  ---------------------------------------------------------------------------*/
+int main(void)
+{
+    bench(4);
+    bench(8);
+    bench(16);
+    printf("%d failures\n", fails);
+    return fails ? 1 : 0;
+} // main()
@@ -0,0 +1,149 @@
+/*==================================================================
+  File Name    : sched_phase.c
+  ------------------------------------------------------------------
+  Purpose : Offline choice of the Delay column of TASK_DATA in
+            src/stc1000p.h. It uses auto_phase() of src/scheduler.c
+            (SCHED_AUTO_PHASE), the model that chooses the phase of every
+            task such that the releases of two tasks are as far apart as
+            possible, and prints TASK_DATA with the chosen phases as the
+            initial delays. With SCHED_DRIFT_FREE, task i is released at
+            Delay + k * Period, so a Delay below the Period is its phase.
+            As evidence it simulates the releases of one hyperperiod,
+            tasks released at the same tick run in table order after the
+            tasks that were released before, and prints the worst-case
+            start latency of every task with:
+            - all delays 0;
+            - the delays of TASK_DATA;
+            - the delays chosen by auto_phase().
+            The program fails if the Delay column of TASK_DATA is not the
+            one chosen, e.g. after a WCET or a period was changed: copy
+            the printed TASK_DATA into stc1000p.h.
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdio.h>
+#include "scheduler.h"
+
+#undef  DISABLE_INTERRUPTS
+#undef  ENABLE_INTERRUPTS
+#define DISABLE_INTERRUPTS
+#define ENABLE_INTERRUPTS
+#undef  SCHED_AUTO_PHASE
+#define SCHED_AUTO_PHASE // auto_phase() of scheduler.c is the model
+
+#include "scheduler.c"
+
+#define US_PER_TICK (1000000L / TICKS_PER_SEC)
+
+#define TASK_FUNC(name, function, delay, period, wcet) #function,
+const char * const task_func[NO_OF_TASKS] = { TASK_DATA(TASK_FUNC) };
+#define TASK_ID(name, function, delay, period, wcet) #name,
+const char * const task_id[NO_OF_TASKS]   = { TASK_DATA(TASK_ID) };
+
+int fails = 0;
+
+#define FAIL(...) do { fails++; printf(__VA_ARGS__); } while (0)
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Stubs of the tasks, timers and event handlers of stc1000p.h,
+             only their addresses are needed.
+  ---------------------------------------------------------------------------*/
+void adc_task(void)      { }
+void std_task(void)      { }
+void ctrl_task(void)     { }
+#if !(defined(OVBSC))
+void prfl_task(void)     { }
+void cool_dly_done(void) { }
+void heat_dly_done(void) { }
+#endif
+void alarm_blink(void)   { }
+void disp_test_done(uint8_t data) { (void)data; }
+void adc_done(uint8_t data)       { (void)data; }
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function simulates the releases of one hyperperiod, from
+             the first release of the last task onwards. A task released
+             at a tick starts when all tasks released before it and the
+             tasks before it in the table, released at the same tick, have
+             finished.
+  Variables: delay: the initial delay of every task in ticks
+             hyper: the hyperperiod in ticks
+             lat  : the worst-case start latency of every task in usec.
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void latency(const uint32_t *delay, uint32_t hyper, uint32_t *lat)
+{
+    uint32_t t, t0 = 0, free_us = 0, start, rel;
+    uint8_t  i;
+
+    for (i = 0; i < NO_OF_TASKS; i++)
+    {
+        lat[i] = 0;
+        if (delay[i] + task_table[i].Period > t0) t0 = delay[i] + task_table[i].Period;
+    } // for
+    for (t = 0; t < t0 + hyper; t++)
+    {
+        for (i = 0; i < NO_OF_TASKS; i++)
+        {
+            if ((t < delay[i] + task_table[i].Period) || ((t - delay[i]) % task_table[i].Period)) continue;
+            rel     = t * US_PER_TICK;
+            start   = (free_us > rel) ? free_us : rel;
+            free_us = start + task_table[i].Wcet;
+            if ((t >= t0) && (start - rel > lat[i])) lat[i] = start - rel;
+        } // for
+    } // for
+} // latency()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : main() chooses the phases, prints TASK_DATA and the latencies.
+  Variables: -
+  Returns  : 0 = the Delay column of TASK_DATA is the chosen one
+  ---------------------------------------------------------------------------*/
+int main(void)
+{
+    uint16_t phase[NO_OF_TASKS];
+    uint32_t zero[NO_OF_TASKS], table[NO_OF_TASKS], chosen[NO_OF_TASKS];
+    uint32_t lat[3][NO_OF_TASKS], hyper = 1;
+    uint8_t  i;
+
+    for (i = 0; i < NO_OF_TASKS; i++)
+    {
+        phase[i]  = auto_phase(i, phase);
+        zero[i]   = 0;
+        table[i]  = task_table[i].Delay;
+        chosen[i] = phase[i];
+        hyper     = hyper / gcd(hyper, task_table[i].Period) * task_table[i].Period;
+    } // for
+    latency(zero  , hyper, lat[0]);
+    latency(table , hyper, lat[1]);
+    latency(chosen, hyper, lat[2]);
+
+    printf("#define TASK_DATA(_) \\\n");
+    for (i = 0; i < NO_OF_TASKS; i++)
+        printf("    _(%s, %-9s, %3u, %5u, %5u)%s\n", task_id[i], task_func[i],
+               (unsigned)(chosen[i] * 1000 / TICKS_PER_SEC), (unsigned)(task_table[i].Period * 1000 / TICKS_PER_SEC),
+               task_table[i].Wcet, (i < NO_OF_TASKS - 1) ? " \\" : "");
+    printf("worst-case start latency (usec.) in a hyperperiod of %u msec.:\n", (unsigned)(hyper * 1000 / TICKS_PER_SEC));
+    printf("task  delays 0  TASK_DATA  chosen\n");
+    for (i = 0; i < NO_OF_TASKS; i++)
+    {
+        printf("%-4s %9u %10u %7u\n", task_id[i], lat[0][i], lat[1][i], lat[2][i]);
+        if (table[i] != chosen[i])
+            FAIL("task %s: Delay is %u msec., the chosen phase is %u msec.\n", task_id[i],
+                 (unsigned)(table[i] * 1000 / TICKS_PER_SEC), (unsigned)(chosen[i] * 1000 / TICKS_PER_SEC));
+    } // for
+    printf("%d failures\n", fails);
+    return fails ? 1 : 0;
+} // main()
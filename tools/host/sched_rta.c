@@ -0,0 +1,281 @@
+/*==================================================================
+  File Name    : sched_rta.c
+  ------------------------------------------------------------------
+  Purpose : Response-time analysis of TASK_DATA and TIMER_DATA in
+            src/stc1000p.h, for the cooperative scheduler of scheduler.c.
+            dispatch_tasks() runs every ready task once per pass, in
+            task_list[] order, and a task is only preempted by interrupts.
+            So between the release of a task and its start, every other
+            task and timer runs at most once, plus one main-loop pass
+            (MAIN_LOOP_WCET). The Timer 2 interrupt adds TIM2_ISR_WCET
+            every msec.: R = C + I + ceil(R / 1 msec.) * TIM2_ISR_WCET,
+            with I the WCETs of the tasks that can run before it.
+            - R(any): critical instant, all tasks are released at the
+              same tick. This holds for any phase, e.g. after
+              set_task_time_period() (HrS) or without SCHED_DRIFT_FREE.
+            - R(offsets): with SCHED_DRIFT_FREE, task j is released at
+              Delay + k * Period. For every release r of a task in the
+              hyperperiod, only the tasks released in (r - R(any), r + R]
+              can run before it. Timers can be started at any tick, so
+              they are always counted. adc_done() (part of the ADC WCET)
+              runs up to ADC_DONE_DELAY after the release of TASK_ADC.
+            Both are printed per task against its period, the program
+            fails if the CPU-utilization is 100 % or more, or if R(any)
+            exceeds the period of a task.
+            It also prints the idle-fraction and an estimate of the supply
+            current of the main-loop in standby (SCHED_ACTIVE_HALT), with
+            the break-even idle time of an active-halt against the
+            wait-for-interrupt that main() otherwise uses.
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdio.h>
+#include "scheduler.h"
+
+#define US_PER_TICK    (1000000L / TICKS_PER_SEC)
+#define ADC_DONE_DELAY (6) // msec., blank slot + settling + conversions, see mux_test
+#define AWU_TICKS      (AWU_MSEC * TICKS_PER_SEC / 1000)
+
+// Estimates of the supply current (mA) of the STM8S103 at 16 MHz (HSI), 5 V
+#define I_RUN          (3.2)   // run, code in flash
+#define I_WFI          (1.0)   // wait-for-interrupt, Timer 2 running
+#define I_HALT         (0.065) // active-halt: main regulator on, flash off, LSI + AWU
+#define T_WAKE         (60)    // usec. at I_RUN to wake up from active-halt (flash)
+
+typedef struct
+{
+    const char *name;
+    long long  delay, period; // ticks
+    long       wcet;          // usec.
+} rta_task;
+
+#define TASK_RTA(name, function, delay, period, wcet) \
+        { #name, MSEC_TO_TICKS(delay), MSEC_TO_TICKS(period), (wcet) },
+#define TIMER_RTA(name, callback, wcet) + (wcet)
+
+const rta_task task[NO_OF_TASKS] = { TASK_DATA(TASK_RTA) };
+const long     timer_wcet        = 0 TIMER_DATA(TIMER_RTA); // usec.
+
+int fails = 0;
+
+#define FAIL(...) do { fails++; printf(__VA_ARGS__); } while (0)
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function returns the response-time of a given amount of
+             work, including the Timer 2 interrupts (fixed-point iteration).
+  Variables: work: WCET of the task plus its interference in usec.
+  Returns  : the response-time in usec.
+  ---------------------------------------------------------------------------*/
+long response(long work)
+{
+    long r = work, prev;
+
+    do
+    {
+        prev = r;
+        r    = work + (prev + US_PER_TICK - 1) / US_PER_TICK * TIM2_ISR_WCET;
+    } while (r != prev);
+    return r;
+} // response()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : These functions return the delay of the work of a task after
+             its release and whether a task is released in a time-window.
+  ---------------------------------------------------------------------------*/
+long long jitter(int j)
+{
+    return (j == TASK_ADC) ? MSEC_TO_TICKS(ADC_DONE_DELAY) : 0;
+} // jitter()
+
+long long floor_div(long long a, long long b)
+{
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+} // floor_div()
+
+int released(int j, long long lo, long long hi) // release in (lo, hi]
+{
+    return floor_div(hi - task[j].delay, task[j].period) > floor_div(lo - task[j].delay, task[j].period);
+} // released()
+
+long long gcd_ll(long long a, long long b)
+{
+    long long t;
+
+    while (b) { t = a % b; a = b; b = t; }
+    return a;
+} // gcd_ll()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function returns the worst-case response-time of task i
+             over all its releases in the hyperperiod, with the initial
+             delays of TASK_DATA (SCHED_DRIFT_FREE).
+  Variables: i    : the task
+             r_any: R(any) in usec.
+             hyper: the hyperperiod in ticks
+             at   : the release with the largest response-time
+             with : bit per task that can run before it at that release
+  Returns  : the response-time in usec.
+  ---------------------------------------------------------------------------*/
+long response_offsets(int i, long r_any, long long hyper, long long *at, unsigned *with)
+{
+    long long r, lo, hi;
+    long      w, prev, work, worst = 0;
+    unsigned  s;
+    int       j;
+
+    for (r = task[i].delay + task[i].period; r < task[i].delay + task[i].period + hyper; r += task[i].period)
+    {
+        w = 0;
+        do
+        {   // the window grows with w, so does the set of tasks in it
+            prev = w;
+            work = task[i].wcet + timer_wcet + MAIN_LOOP_WCET;
+            s    = 0;
+            for (j = 0; j < NO_OF_TASKS; j++)
+            {
+                lo = r - (r_any + US_PER_TICK - 1) / US_PER_TICK - jitter(j);
+                hi = r + (prev + US_PER_TICK - 1) / US_PER_TICK;
+                if ((j != i) && released(j, lo, hi))
+                {
+                    work += task[j].wcet;
+                    s    |= 1U << j;
+                } // if
+            } // for
+            w = response(work);
+        } while (w > prev);
+        w += jitter(i) * US_PER_TICK;
+        if (w > worst)
+        {
+            worst = w;
+            *at   = r;
+            *with = s;
+        } // if
+    } // for
+    return worst;
+} // response_offsets()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function models the main-loop over one hyperperiod, with
+             the WCETs of TASK_DATA from their release onwards, and returns
+             the average supply current. When nothing is ready, main()
+             halts for AWU_MSEC while the next release is more than 
+             AWU_MSEC + 1 ticks away (if halt is true), otherwise it waits
+             for the next Timer 2 interrupt.
+  Variables: hyper: the hyperperiod in ticks
+             halt : true = active-halt is used
+             idle : the idle fraction
+             halts: the number of active-halts per hyperperiod
+  Returns  : the average supply current in mA
+  ---------------------------------------------------------------------------*/
+double power(long long hyper, bool halt, double *idle, long *halts)
+{
+    long long t, d;
+    double    run = 0, wfi = 0, ah = 0; // usec.
+    long      busy = 0, r;
+    int       j, rel;
+
+    *halts = 0;
+    for (t = 0; t < hyper; t++)
+    {
+        for (j = rel = 0; j < NO_OF_TASKS; j++)
+        {
+            if (!released(j, t - 1, t)) continue;
+            busy += task[j].wcet;
+            rel   = 1;
+        } // for
+        if (rel) busy += MAIN_LOOP_WCET; // one main-loop pass
+        r     = (busy < US_PER_TICK - TIM2_ISR_WCET) ? busy : US_PER_TICK - TIM2_ISR_WCET;
+        busy -= r;
+        run  += r + TIM2_ISR_WCET;
+        wfi  += US_PER_TICK - TIM2_ISR_WCET - r;
+        if (!halt || busy) continue;
+        for (d = 1; d <= AWU_TICKS + 1; d++)
+        {   // is the next release more than AWU_MSEC + 1 ticks away?
+            for (j = 0; j < NO_OF_TASKS; j++) if (released(j, t + d - 1, t + d)) break;
+            if (j < NO_OF_TASKS) break;
+        } // for
+        if (d <= AWU_TICKS + 1) continue;
+        ah  += AWU_TICKS * US_PER_TICK;
+        run += T_WAKE;
+        t   += AWU_TICKS;
+        (*halts)++;
+    } // for
+    *idle = (wfi + ah) / (run + wfi + ah);
+    return (run * I_RUN + wfi * I_WFI + ah * I_HALT) / (run + wfi + ah);
+} // power()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : main() prints the utilization and the response-times of all
+             tasks of TASK_DATA.
+  Variables: -
+  Returns  : 0 = all tasks meet their period
+  ---------------------------------------------------------------------------*/
+int main(void)
+{
+    long long hyper = 1, at = 0;
+    double    util  = (double)TIM2_ISR_WCET / US_PER_TICK;
+    long      sum   = timer_wcet + MAIN_LOOP_WCET, r_any, r_off, period;
+    unsigned  with  = 0;
+    int       i, j;
+    double    i_wfi, i_halt, idle;
+    long      halts;
+
+    for (i = 0; i < NO_OF_TASKS; i++)
+    {
+        sum   += task[i].wcet;
+        util  += (double)task[i].wcet / (task[i].period * US_PER_TICK);
+        hyper  = hyper / gcd_ll(hyper, task[i].period) * task[i].period;
+    } // for
+    r_any = response(sum);
+    printf("%s: %d tasks, timers %ld usec., main-loop %ld usec., Timer 2 interrupt %d usec. every msec.\n",
+#if defined(OVBSC)
+           "OVBSC",
+#else
+           "STC1000P",
+#endif
+           NO_OF_TASKS, timer_wcet, (long)MAIN_LOOP_WCET, TIM2_ISR_WCET);
+    printf("CPU-utilization %.2f %%, hyperperiod %lld msec.\n", 100.0 * util, hyper * 1000 / TICKS_PER_SEC);
+    if (util >= 1.0) FAIL("CPU-utilization is 100 %% or more\n");
+    printf("task    period  delay   WCET  R(any)  R(offsets)  at tick  after\n");
+    for (i = 0; i < NO_OF_TASKS; i++)
+    {
+        period = task[i].period * US_PER_TICK;
+#if defined(SCHED_DRIFT_FREE)
+        r_off = response_offsets(i, r_any, hyper, &at, &with);
+#else
+        r_off = r_any; // releases drift with the run-times, no offsets
+#endif
+        printf("%-4s %9lld %6lld %6ld %7.2f %11.2f %8lld  ", task[i].name, task[i].period * 1000 / TICKS_PER_SEC,
+               task[i].delay * 1000 / TICKS_PER_SEC, task[i].wcet, (r_any + jitter(i) * US_PER_TICK) / 1000.0,
+               r_off / 1000.0, at);
+        if (!with) printf("-");
+        for (j = 0; j < NO_OF_TASKS; j++) if (with & (1U << j)) printf("%s ", task[j].name);
+        printf("\n");
+        if (r_any + jitter(i) * US_PER_TICK > period)
+            FAIL("task %s: R(any) %ld usec. exceeds its period\n", task[i].name, r_any + (long)jitter(i) * US_PER_TICK);
+    } // for
+    printf("R in msec., includes timers, main-loop and interrupts\n");
+    i_wfi  = power(hyper, false, &idle, &halts);
+    printf("standby: idle %.1f %% of the time with the WCETs, wait-for-interrupt only: %.3f mA\n",
+           100.0 * idle, i_wfi);
+    i_halt = power(hyper, true, &idle, &halts);
+    printf("standby: %ld active-halts of %d msec. per %lld msec., %.1f %% halted: %.3f mA\n",
+           halts, AWU_MSEC, hyper * 1000 / TICKS_PER_SEC, 100.0 * halts * AWU_TICKS / hyper, i_halt);
+    printf("active-halt pays off for an idle time above %.3f msec.: the threshold of\n"
+           "AWU_MSEC + 1 = %d ticks is set by the fixed AWU period, not by the energy\n", 
+           T_WAKE * I_RUN / (I_WFI - I_HALT) / 1000.0, (int)AWU_TICKS + 1);
+    printf("%d failures\n", fails);
+    return fails ? 1 : 0;
+} // main()
@@ -0,0 +1,447 @@
+/*==================================================================
+  File Name    : sched_test.c
+  ------------------------------------------------------------------
+  Purpose : Host test and benchmark of the delta-queue in src/scheduler.c,
+            with the tasks of TASK_DATA and the timers of TIMER_DATA:
+            - equivalence: for one hour of ticks, every task is released
+              at the same ticks as with the linear scan of all tasks in
+              scheduler_isr() before the delta-queue (git 6183f56^).
+            - random: start_timer(), cancel_timer(), set_task_time_period(),
+              enable_task(), disable_task() and scheduler_advance() at
+              random ticks, checked against the absolute release tick of
+              every task and timer. After every change the delta-queue is
+              walked: every entry once, counters add up to its release.
+            - drift: 14 days of the main-loop with SCHED_DRIFT_FREE. Idle
+              ticks are skipped with scheduler_advance(), some of them
+              as active-halts that end after the next release, and tasks
+              start up to 20 msec. late. Every release must be on the 
+              grid of its Delay and Period and none may be lost.
+            - wrap: random and the main-loop for one hour around the wrap
+              of sched_ticks, with tasks up to 350 msec. late: the
+              overruns must match the grid ticks missed.
+            - stats (SCHED_STATS): the start latency is measured with the
+              1 MHz TIM1 counter, which wraps after 65.5 msec. A task that
+              starts more than STATS_LATE_MAX ticks late must give a
+              LatencyMax of 0xFFFF, not the wrapped time.
+            - benchmark: host time per tick of both scheduler_isr()
+              versions, only an indication for the STM8. See sched_bench
+              for 4, 8 and 16 tasks.
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "scheduler.h"
+
+#undef  DISABLE_INTERRUPTS
+#undef  ENABLE_INTERRUPTS
+#define DISABLE_INTERRUPTS
+#define ENABLE_INTERRUPTS
+
+#include "scheduler.c"
+
+#define HOUR      (3600L * TICKS_PER_SEC)
+#define DAYS      (14L * 24 * HOUR)  // drift simulation
+#define AWU_TICKS (AWU_MSEC * TICKS_PER_SEC / 1000)
+#define WRAP      (0xFFFFFFFFUL - HOUR / 2) // start half an hour before the wrap
+#define NOT_DUE   (0xFFFFFFFFUL)
+#define BENCH     (10000000L) // ticks per benchmark
+
+int      fails = 0;
+uint32_t ran;            // bit per task/timer that ran at this tick
+uint32_t due[NO_OF_ENTRIES]; // absolute release tick, NOT_DUE = stopped
+uint32_t per[NO_OF_ENTRIES]; // period in ticks, 0 = one-shot timer
+bool     ena[NO_OF_ENTRIES]; // task enabled
+
+#define FAIL(...) do { if (fails++ < 10) printf(__VA_ARGS__); } while (0)
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Stubs of the tasks, timers and event handlers of stc1000p.h,
+             every task and timer sets its bit in ran.
+  ---------------------------------------------------------------------------*/
+void adc_task(void)      { ran |= 1UL << TASK_ADC; }
+void std_task(void)      { ran |= 1UL << TASK_STD; }
+void ctrl_task(void)     { ran |= 1UL << TASK_CTL; }
+#if !(defined(OVBSC))
+void prfl_task(void)     { ran |= 1UL << TASK_PRF; }
+void cool_dly_done(void) { ran |= 1UL << TMR_COOL_DLY; }
+void heat_dly_done(void) { ran |= 1UL << TMR_HEAT_DLY; }
+#endif
+void alarm_blink(void)   { ran |= 1UL << TMR_ALM_BLINK; }
+void disp_test_done(uint8_t data) { (void)data; }
+void adc_done(uint8_t data)       { (void)data; }
+
+/*-----------------------------------------------------------------------------
+  Purpose  : scheduler_isr() and dispatch_tasks() before the delta-queue
+             (git 6183f56^): every tick the Delay or Counter of every task
+             is decremented.
+  ---------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Period, Delay, Counter;
+    uint8_t  Status;
+} old_task;
+
+old_task old_list[NO_OF_TASKS];
+
+void old_init(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < NO_OF_TASKS; i++)
+    {
+        old_list[i].Period  = old_list[i].Counter = task_table[i].Period;
+        old_list[i].Delay   = task_table[i].Delay;
+        old_list[i].Status  = TASK_ENABLED;
+    } // for
+} // old_init()
+
+void old_isr(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < NO_OF_TASKS; i++)
+    {
+        if (old_list[i].Delay > 0) old_list[i].Delay--;
+        else if (--old_list[i].Counter == 0) old_list[i].Status |= TASK_READY;
+    } // for
+} // old_isr()
+
+uint32_t old_dispatch(void)
+{
+    uint32_t r = 0;
+    uint8_t  i;
+
+    for (i = 0; i < NO_OF_TASKS; i++)
+    {
+        if ((old_list[i].Status & (TASK_READY | TASK_ENABLED)) == (TASK_READY | TASK_ENABLED))
+        {
+            r |= 1UL << i;
+            old_list[i].Status  &= ~TASK_READY;
+            old_list[i].Counter  = old_list[i].Period;
+        } // if
+    } // for
+    return r;
+} // old_dispatch()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function starts the scheduler and the reference model
+             with the tasks of TASK_DATA.
+  Variables: start: sched_ticks at the start
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void sched_init(uint32_t start)
+{
+    uint8_t i;
+
+    memset(task_list, 0, sizeof(task_list));
+    q_head      = NO_TASK;
+    sched_ticks = start;
+    init_tasks();
+    for (i = 0; i < NO_OF_ENTRIES; i++)
+    {
+        due[i] = (i < NO_OF_TASKS) ? start + task_table[i].Delay + task_table[i].Period : NOT_DUE;
+        per[i] = task_table[i].Period;
+        ena[i] = true;
+    } // for
+} // sched_init()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function runs the scheduler for one tick.
+  Variables: -
+  Returns  : the bits of the tasks and timers that ran
+  ---------------------------------------------------------------------------*/
+uint32_t sched_tick(void)
+{
+    ran = 0;
+    scheduler_isr();
+    if (sched_pending) dispatch_tasks();
+    return ran;
+} // sched_tick()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function walks the delta-queue and compares the release
+             tick of every entry with the reference model.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void check_queue(void)
+{
+    uint32_t t = sched_ticks, seen = 0;
+    uint8_t  i, n = 0;
+
+    for (i = q_head; i != NO_TASK; i = task_list[i].Next)
+    {
+        if ((i >= NO_OF_ENTRIES) || (seen & (1UL << i)) || (++n > NO_OF_ENTRIES))
+        {
+            FAIL("tick %u: delta-queue corrupted\n", sched_ticks);
+            return;
+        } // if
+        seen |= 1UL << i;
+        t    += task_list[i].Counter;
+        if (t != due[i]) FAIL("tick %u: entry %d due at %u instead of %u\n", sched_ticks, i, t, due[i]);
+    } // for
+    for (i = 0; i < NO_OF_ENTRIES; i++)
+        if (!(seen & (1UL << i)) && (due[i] != NOT_DUE))
+            FAIL("tick %u: entry %d not in the delta-queue\n", sched_ticks, i);
+} // check_queue()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function compares the releases of one hour with the
+             linear scan of the old scheduler.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void equivalence(void)
+{
+    uint32_t r_new, r_old;
+    long     t, runs = 0;
+
+    sched_init(0);
+    old_init();
+    for (t = 1; t <= HOUR; t++)
+    {
+        r_new = sched_tick();
+        old_isr();
+        r_old = old_dispatch();
+        if (r_new != r_old) FAIL("tick %ld: tasks 0x%x instead of 0x%x\n", t, r_new, r_old);
+        runs += __builtin_popcount(r_new);
+    } // for
+    printf("equivalence: %ld ticks, %ld task runs\n", HOUR, runs);
+} // equivalence()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function changes tasks and timers at random ticks and
+             checks every release against the reference model.
+  Variables: start: sched_ticks at the start
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void random_ops(uint32_t start)
+{
+    uint32_t expect, r, n, ms;
+    long     t, ops = 0;
+    uint8_t  i, id;
+
+    srand(1);
+    sched_init(start);
+    for (t = 1; t <= HOUR; t++)
+    {
+        r = sched_tick();
+        expect = 0;
+        for (i = 0; i < NO_OF_ENTRIES; i++)
+        {
+            if (due[i] != sched_ticks) continue;
+            if (ena[i]) expect |= 1UL << i;
+            due[i] = per[i] ? sched_ticks + per[i] : NOT_DUE;
+        } // for
+        if (r != expect) FAIL("tick %u: ran 0x%x instead of 0x%x\n", sched_ticks, r, expect);
+        if (rand() % 50) continue;
+        ops++;
+        id = rand() % NO_OF_ENTRIES;
+        ms = 1 + rand() % 3000;
+        switch (rand() % 6)
+        {
+            case 0: // (re)start a timer
+                if (id < NO_OF_TASKS) break;
+                per[id] = (rand() & 1) ? 1 + rand() % 500 : 0;
+                start_timer(id, ms, per[id]);
+                due[id] = sched_ticks + ms;
+                break;
+            case 1: // stop a timer
+                if (id < NO_OF_TASKS) break;
+                cancel_timer(id);
+                due[id] = NOT_DUE;
+                break;
+            case 2: // new period of a task
+                if (id >= NO_OF_TASKS) break;
+                set_task_time_period(ms, id);
+                per[id] = ms;
+                due[id] = sched_ticks + ms;
+                break;
+            case 3: // enable or disable a task
+                if (id >= NO_OF_TASKS) break;
+                ena[id] = !ena[id];
+                if (ena[id]) enable_task(id);
+                else         disable_task(id);
+                break;
+            default: // halt until before the next release
+                n = sched_next_release();
+                if (n > 1) scheduler_advance(rand() % (n - 1) + 1);
+                break;
+        } // switch
+        check_queue();
+    } // for
+    printf("random     : ticks %u..%u, %ld changes\n", start, sched_ticks, ops);
+} // random_ops()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function runs the main-loop and checks that every task is
+             released on its grid, also after an active-halt that ends 
+             after the next release: the LSI of the AWU is only accurate to
+             about 12 %, so a halt of AWU_MSEC can take up to AWU_TICKS * 9/8
+             ticks. Tasks start up to late ticks after a release; releases
+             that pass meanwhile must be counted as overruns, exactly.
+  Variables: name : name of the run
+             start: sched_ticks at the start
+             ticks: length of the run
+             late : maximum start latency in ticks
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void grid_run(const char *name, uint32_t start, uint32_t ticks, uint16_t late)
+{
+    uint32_t n, k, nom[NO_OF_TASKS], over[NO_OF_TASKS], halts = 0, crossed = 0, sum = 0;
+    uint8_t  i;
+
+    srand(2);
+    sched_init(start);
+    for (i = 0; i < NO_OF_TASKS; i++)
+    {
+        nom[i]  = start + task_table[i].Delay + task_table[i].Period; // next grid tick
+        over[i] = 0;
+    } // for
+    while (sched_ticks - start < ticks)
+    {
+        n = sched_next_release();
+        if (rand() % 8 == 0)
+        {   // active-halt, may end after the next release
+            k = 1 + rand() % (AWU_TICKS * 9 / 8);
+            if (k >= n) crossed++;
+            halts++;
+            scheduler_advance(k);
+        } // if
+        else
+        {   // wait-for-interrupt until the next release
+            if (n > 1) scheduler_advance(n - 1);
+            scheduler_isr();
+        } // else
+        if (!sched_pending) continue;
+        for (k = rand() % late; k > 0; k--) scheduler_isr(); // earlier tasks still running
+        for (i = 0; i < NO_OF_TASKS; i++)
+        {
+            if (!(task_list[i].Status & TASK_READY)) continue;
+            if (task_list[i].Release != nom[i])
+                FAIL("%s: task %d released at tick %u instead of %u\n", name, i, task_list[i].Release, nom[i]);
+            k        = (sched_ticks - nom[i]) / task_table[i].Period; // grid ticks passed until it runs
+            over[i] += k;
+            nom[i]  += (k + 1) * task_table[i].Period;
+        } // for
+        dispatch_tasks();
+    } // while
+    for (i = 0; i < NO_OF_TASKS; i++)
+    {
+        if ((int32_t)(nom[i] - sched_ticks) <= 0) FAIL("%s: task %d not released at tick %u\n", name, i, nom[i]);
+        if (task_list[i].Overruns != over[i])
+            FAIL("%s: task %d has %u overruns instead of %u\n", name, i, task_list[i].Overruns, over[i]);
+        sum += over[i];
+    } // for
+    printf("%-11s: ticks %u..%u, %u halts (%u past a release), %u overruns\n",
+           name, start, sched_ticks, halts, crossed, sum);
+} // grid_run()
+
+#if defined(SCHED_STATS)
+/*-----------------------------------------------------------------------------
+  Purpose  : This function runs scheduler_isr() for one tick, with the TIM1
+             counter of stats_timer() at 1000 usec. per tick.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void stats_tick(void)
+{
+    uint16_t us = (uint16_t)((sched_ticks + 1) * (1000000L / TICKS_PER_SEC));
+
+    TIM1.CNTR.byteH = us >> 8;
+    TIM1.CNTR.byteL = us & 0xff;
+    scheduler_isr();
+} // stats_tick()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function starts the first released task late ticks after
+             its release and checks its LatencyMax.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void stats_test(void)
+{
+    const uint32_t late[] = { 10, STATS_LATE_MAX, STATS_LATE_MAX + 1, 100, 1000 };
+    task_stats s;
+    uint32_t   t, expect;
+    uint8_t    i, k;
+
+    for (k = 0; k < sizeof(late) / sizeof(late[0]); k++)
+    {
+        sched_init(0);
+        do stats_tick(); while (!sched_pending);
+        for (i = 0; !(task_list[i].Status & TASK_READY); i++) ; // first released task
+        for (t = 0; t < late[k]; t++) stats_tick();
+        dispatch_tasks();
+        s.LatencyMax = 0;
+        get_task_stats(i, &s);
+        expect = (late[k] > STATS_LATE_MAX) ? 0xFFFF : late[k] * (1000000L / TICKS_PER_SEC);
+        if (s.LatencyMax != expect)
+            FAIL("stats: task %d started %u ticks late, latency %u usec. instead of %u\n", i, (unsigned)late[k], s.LatencyMax, (unsigned)expect);
+    } // for
+    printf("stats      : latency up to %ld ticks measured, saturated above\n", STATS_LATE_MAX);
+} // stats_test()
+#endif
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This function measures the host time per tick of the
+             delta-queue and of the linear scan.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void benchmark(void)
+{
+    clock_t c;
+    double  ns_new, ns_old;
+    long    t;
+
+    sched_init(0);
+    c = clock();
+    for (t = 0; t < BENCH; t++) sched_tick();
+    ns_new = (double)(clock() - c) * 1e9 / CLOCKS_PER_SEC / BENCH;
+    old_init();
+    c = clock();
+    for (t = 0; t < BENCH; t++)
+    {
+        old_isr();
+        ran = old_dispatch();
+    } // for
+    ns_old = (double)(clock() - c) * 1e9 / CLOCKS_PER_SEC / BENCH;
+    printf("benchmark  : %.1f ns/tick delta-queue, %.1f ns/tick linear scan (%d tasks)\n",
+           ns_new, ns_old, NO_OF_TASKS);
+} // benchmark()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : main() runs all tests.
+  Variables: -
+  Returns  : 0 = all passed
+  ---------------------------------------------------------------------------*/
+int main(void)
+{
+    equivalence();
+    random_ops(0);
+    random_ops(WRAP);
+    grid_run("drift", 0, DAYS, 20);
+    grid_run("wrap", WRAP, HOUR, 350);
+#if defined(SCHED_STATS)
+    stats_test();
+#endif
+    benchmark();
+    printf("%d failures\n", fails);
+    return fails ? 1 : 0;
+} // main()
@@ -0,0 +1,109 @@
+/*==================================================================
+  File Name    : temp_test.c
+  ------------------------------------------------------------------
+  Purpose : Host test of ad_to_temp() in src/temp.c for all 65536
+            values of adfilter:
+            - exact: the result is 10 * (L[b] + a * (L[b+1] - L[b]) / 2^n)
+              rounded to E-2 degrees C, the same arithmetic as
+              interpolate() in tools/ntc_table.py.
+            - equivalence: the 64-step loop that ad_to_temp() used
+              before the direct interpolation (E-1 degrees C, only the
+              upper 6 bits of a) gives the same temperature, rounded to
+              E-1, when the lower bits of a are 0. Otherwise it differs
+              less than a 6-bit step of the table entry.
+            - the out-of-limits flag.
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "temp.c"
+
+int fails = 0;
+
+#define FAIL(...) do { if (fails++ < 10) printf(__VA_ARGS__); } while (0)
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Stub for scheduler.c, not used by ad_to_temp().
+  ---------------------------------------------------------------------------*/
+uint8_t post_event(uint8_t type, uint8_t data)
+{
+    (void)type; (void)data;
+    return 0;
+} // post_event()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : ad_to_temp() before the direct interpolation (git 780ceca^),
+             for the Celsius table. b = 31 is not tested, the loop read
+             past the end of the table there.
+  Variables: adfilter: the filtered ADC-value, 16-bit full-scale
+  Returns  : the temperature in E-1 degrees C
+  ---------------------------------------------------------------------------*/
+int16_t ad_to_temp_loop(uint16_t adfilter)
+{
+    uint8_t i;
+    long    temp = 32;
+    uint8_t a = ((adfilter >> 5) & 0x3f);  // Lower 6 bits
+    uint8_t b = ((adfilter >> 11) & 0x1f); // Upper 5 bits
+
+    for (i = 0; i < 64; i++)
+    {
+        if (a <= i) temp += ad_lookup_c[b];
+        else        temp += ad_lookup_c[b+1];
+    } // for
+    return (temp >> 6);
+} // ad_to_temp_loop()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : main() tests ad_to_temp() for all values of adfilter.
+  Variables: -
+  Returns  : 0 = all passed
+  ---------------------------------------------------------------------------*/
+int main(void)
+{
+    uint32_t x;
+    uint16_t a;
+    uint8_t  b;
+    int16_t  t, t_loop, d;
+    double   exact;
+    bool     err;
+    long     same = 0;
+
+    for (x = 0; x < 0x10000; x++)
+    {
+        t = ad_to_temp((uint16_t)x, &err);
+        a = x & NTC_MASK_A;
+        b = x >> NTC_SHIFT_B;
+        d = (b < NTC_TABLE_SIZE - 1) ? ad_lookup_c[b + 1] - ad_lookup_c[b] : 0;
+        exact = 10.0 * (ad_lookup_c[b] + (double)a * d / (1L << NTC_SHIFT_B));
+        if (t != (int16_t)floor(exact + 0.5))
+            FAIL("%5u: %d, exact %.2f\n", x, t, exact);
+        if (err != (((x >> 8) >= 248) || ((x >> 8) <= 8)))
+            FAIL("%5u: out-of-limits flag %d\n", x, err);
+        if ((NTC_TABLE_BITS != 5) || (b == NTC_TABLE_SIZE - 1)) continue;
+        t_loop = ad_to_temp_loop((uint16_t)x);
+        if (!(x & 0x1f))
+        {   // same a as the loop: same temperature, rounded to E-1
+            if (t_loop != (int16_t)floor(exact / 10.0 + 0.5))
+                FAIL("%5u: loop %d, exact %.2f\n", x, t_loop, exact);
+            else same++;
+        } // if
+        else if (fabs(exact - 10 * t_loop) > 5 + 10.0 * abs(d) / 64)
+            FAIL("%5u: loop %d, exact %.2f\n", x, t_loop, exact);
+    } // for
+    printf("ad_to_temp(): 65536 values, %ld equal to the 64-step loop, %d failures\n", same, fails);
+    return fails ? 1 : 0;
+} // main()
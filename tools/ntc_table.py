@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""==================================================================
+  File Name    : ntc_table.py
+  ------------------------------------------------------------------
+  Purpose : Generates src/ntc_table.h, the NTC lookup table used by
+            ad_to_temp() in temp.c, from the thermistor parameters.
+            The NTC is given either by its Beta value or by its
+            Steinhart-Hart coefficients. The table has 32, 64 or 128
+            entries; entry k is the temperature in E-1 degrees Celsius
+            at k / size of the ADC full-scale. The table does not depend
+            on the ADC resolution: temp.c scales the filtered ADC-value
+            to 16 bits. A report with the maximum interpolation error
+            per temperature range is printed.
+
+            Examples:
+              ntc_table.py --beta 3950 --r25 10000
+              ntc_table.py --sh 8.725e-4 2.540e-4 1.822e-7 --size 64
+  ------------------------------------------------------------------
+  STC1000+ is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  STC1000+ is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with STC1000+.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+"""
+import argparse
+import math
+import os
+import sys
+
+FILTER_BITS = 16  # ad_to_temp() gets the filtered ADC-value, 16-bit full-scale
+T0          = 273.15
+SIZES       = {32: 5, 64: 6, 128: 7}
+
+
+def ntc_resistance(ratio, args):
+    """NTC resistance for an ADC-value as a fraction (0..1) of full-scale."""
+    if args.ntc_low:  # NTC between ADC-input and GND
+        return args.rs * ratio / (1.0 - ratio)
+    return args.rs * (1.0 - ratio) / ratio  # NTC between Vref and ADC-input
+
+
+def temperature(r, args):
+    """Temperature in degrees Celsius of the NTC with resistance r."""
+    if args.sh:
+        a, b, c = args.sh
+        ln_r = math.log(r)
+        return 1.0 / (a + b * ln_r + c * ln_r ** 3) - T0
+    return 1.0 / (1.0 / (args.t25 + T0) + math.log(r / args.r25) / args.beta) - T0
+
+
+def temp_at(ratio, args):
+    """Temperature for an ADC-ratio, None when outside of the NTC range."""
+    if ratio <= 0.0 or ratio >= 1.0:
+        return None
+    return temperature(ntc_resistance(ratio, args), args)
+
+
+def make_table(args):
+    """Table in E-1 degrees Celsius. Entry 0 (ADC-value 0) has no temperature and
+       is extrapolated from entries 1 and 2, it is always out-of-limits."""
+    table = [None] * args.size
+    for k in range(1, args.size):
+        t = temp_at(k / args.size, args)
+        table[k] = int(round(t * 10))
+    table[0] = 2 * table[1] - table[2]
+    return table
+
+
+def interpolate(table, code):
+    """Same arithmetic as ad_to_temp(), code is the 16-bit ADC-value.
+       The result is in E-2 degrees C."""
+    bits_a = FILTER_BITS - SIZES[len(table)]
+    b = code >> bits_a
+    a = code & ((1 << bits_a) - 1)
+    temp = table[b] << bits_a
+    if b < len(table) - 1:
+        temp += a * (table[b + 1] - table[b])
+    return (temp * 10 + (1 << (bits_a - 1))) >> bits_a
+
+
+def error_report(table, args, lo_limit, hi_limit):
+    """Max. interpolation error (E-1 degrees C) per 10 degrees C range."""
+    ranges = {}
+    for code in range(lo_limit, hi_limit, 16):  # out-of-limits skipped, see ad_to_temp()
+        t = temp_at(code / float(1 << FILTER_BITS), args)
+        if t is None:
+            continue
+        err = abs(interpolate(table, code) / 100.0 - t)
+        key = int(math.floor(t / 10.0)) * 10
+        ranges[key] = max(ranges.get(key, 0.0), err)
+    return ranges
+
+
+def command_line():
+    """Options of this run without the output file, to regenerate the table."""
+    argv, opts = sys.argv[1:], []
+    while argv:
+        arg = argv.pop(0)
+        if arg in ('-o', '--output'):
+            argv = argv[1:]
+        elif not arg.startswith('--output='):
+            opts.append(arg)
+    return opts
+
+
+def c_array(name, table):
+    return 'const int %s[] = {%s};\n' % (name, ','.join(str(x) for x in table))
+
+
+def main():
+    p = argparse.ArgumentParser(description='Generate the NTC lookup table for temp.c')
+    p.add_argument('--beta', type=float, default=3950.0, help='Beta value of the NTC [K]')
+    p.add_argument('--r25', type=float, default=10000.0, help='NTC resistance at T25 [Ohm]')
+    p.add_argument('--t25', type=float, default=25.0, help='Reference temperature for Beta [C]')
+    p.add_argument('--sh', type=float, nargs=3, metavar=('A', 'B', 'C'),
+                   help='Steinhart-Hart coefficients, used instead of Beta')
+    p.add_argument('--rs', type=float, default=10000.0, help='Series resistor [Ohm]')
+    p.add_argument('--ntc-low', action='store_true',
+                   help='NTC between ADC-input and GND (default: between Vref and ADC-input)')
+    p.add_argument('--size', type=int, default=32, choices=sorted(SIZES), help='Number of table entries')
+    p.add_argument('-o', '--output', default=os.path.join(os.path.dirname(__file__), '..', 'src', 'ntc_table.h'),
+                   help='Output header file')
+    args = p.parse_args()
+
+    tc = make_table(args)
+
+    # Same out-of-limits check as ad_to_temp(): 8 < (adfilter >> 8) < 248
+    lo_limit, hi_limit = 9 << 8, 248 << 8
+    report = error_report(tc, args, lo_limit, hi_limit)
+
+    if args.sh:
+        ntc = 'Steinhart-Hart A=%g B=%g C=%g' % tuple(args.sh)
+    else:
+        ntc = 'Beta=%g K, R%g=%g Ohm' % (args.beta, args.t25, args.r25)
+    with open(args.output, 'w') as f:
+        f.write('/*==================================================================\n')
+        f.write('  File Name    : ntc_table.h\n')
+        f.write('  ------------------------------------------------------------------\n')
+        f.write('  Purpose : NTC lookup table for ad_to_temp(), only included by temp.c\n')
+        f.write('            Generated by tools/ntc_table.py, do not edit:\n')
+        f.write('              %s\n' % ' '.join(['tools/ntc_table.py'] + command_line()))
+        f.write('            NTC: %s\n' % ntc)
+        f.write('            Series resistor: %g Ohm, NTC to %s\n' % (args.rs, 'GND' if args.ntc_low else 'Vref'))
+        f.write('            Max. interpolation error: %.2f C\n' % max(report.values()))
+        f.write('  ==================================================================\n')
+        f.write('*/\n')
+        f.write('#ifndef NTC_TABLE_H\n#define NTC_TABLE_H\n\n')
+        f.write('#define NTC_TABLE_BITS (%d) // %d entries\n\n' % (SIZES[args.size], args.size))
+        f.write('/* Temperature lookup table in E-1 degrees Celsius */\n')
+        f.write(c_array('ad_lookup_c', tc))
+        f.write('#endif\n')
+
+    print('%s: %d entries, %s' % (args.output, args.size, ntc))
+    print('Range [C]   Max. error [C]')
+    for key in sorted(report):
+        print('%4d..%4d  %6.2f' % (key, key + 10, report[key]))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,11 @@
+# PlatformIO extra script: adds the custom target 'ntc_table', which runs
+# tools/ntc_table.py with the options of custom_ntc_args in platformio.ini.
+# Usage: pio run -t ntc_table
+Import("env")
+
+env.AddCustomTarget(
+    name="ntc_table",
+    dependencies=None,
+    actions=["$PYTHONEXE tools/ntc_table.py " + env.GetProjectOption("custom_ntc_args", "")],
+    title="NTC table",
+    description="Generate src/ntc_table.h from the NTC parameters")